@@ -26,7 +26,7 @@ SOFTWARE.
 #include "PolyVoxPrivatePCH.h"
 #include "Utils/Morton.h"
 #include "Paging/PagedVolume.h"
-#include "Paging/PagedChunk.h"
+#include "Paging/PagedChunkData.h"
 #include <array>
 #include "VolumeSampler.h"
 
@@ -50,13 +50,35 @@ static const std::array<int32, 256> deltaZ = {{ 4, 28, 4, 220, 4, 28, 4, 1756, 4
 
 
 UVolumeSampler::UVolumeSampler(UPagedVolumeComponent* VolumeData)
+	: UVolumeSampler(VolumeData, ESamplerBorderPolicy::PageIn)
+{
+}
+
+UVolumeSampler::UVolumeSampler(UPagedVolumeComponent* VolumeData, ESamplerBorderPolicy Policy, FVoxel Border /*= FVoxel::GetEmptyVoxel()*/)
+	: Accessor(VolumeData, Policy != ESamplerBorderPolicy::PageIn)
 {
 	checkf(VolumeData != NULL, TEXT("Provided volume cannot be null"));
 	Volume = VolumeData;
 	ChunkSideLengthMinusOne = Volume->GetChunkSideLength() - 1;
+	CurrentChunk = NULL;
+	CurrentVoxels = NULL;
+	CurrentVoxelIndex = 0;
+	XPosInVolume = 0;
+	YPosInVolume = 0;
+	ZPosInVolume = 0;
+	XPosInChunk = 0;
+	YPosInChunk = 0;
+	ZPosInChunk = 0;
+
+	BorderPolicy = Policy;
+	BorderVoxel = Border;
+	NonResidentReads = 0;
+	bHasClampChunk = false;
+	ClampChunkPosition = FIntVector::ZeroValue;
 }
 
 UVolumeSampler::UVolumeSampler(const UVolumeSampler& Sampler)
+	: Accessor(Sampler.Accessor)
 {
 	Volume = Sampler.Volume;
 	ChunkSideLengthMinusOne = Volume->GetChunkSideLength() - 1;
@@ -71,19 +93,237 @@ UVolumeSampler::UVolumeSampler(const UVolumeSampler& Sampler)
 
 	CurrentVoxelIndex = Sampler.CurrentVoxelIndex;
 	CurrentChunk = Sampler.CurrentChunk;
+	CurrentVoxels = Sampler.CurrentVoxels;
+
+	BorderPolicy = Sampler.BorderPolicy;
+	BorderVoxel = Sampler.BorderVoxel;
+	NonResidentReads = 0;
+	bHasClampChunk = Sampler.bHasClampChunk;
+	ClampChunkPosition = Sampler.ClampChunkPosition;
 }
 
-FVoxel UVolumeSampler::GetVoxel()
+FVoxel UVolumeSampler::GetVoxelOutsideChunk()
 {
-	if (CurrentChunk == NULL)
+	if (BorderPolicy != ESamplerBorderPolicy::PageIn)
 	{
-		UE_LOG(LogPolyVox, Log, TEXT("Current chunk was null. Getting by coordinates."));
-		return Volume->GetVoxelByCoordinates(XPosInVolume, YPosInVolume, ZPosInVolume);
+		return GetNonResidentVoxel(XPosInVolume, YPosInVolume, ZPosInVolume);
 	}
 	else
 	{
-		return CurrentChunk->GetDataAtIndex(CurrentVoxelIndex);
+		// Only a sampler which hasn't been given a position yet gets here
+		UE_LOG(LogPolyVox, Verbose, TEXT("Current chunk was null. Getting by coordinates."));
+		return Accessor.GetVoxel(XPosInVolume, YPosInVolume, ZPosInVolume);
+	}
+}
+
+FVoxel UVolumeSampler::GetNonResidentVoxel(int32 XPos, int32 YPos, int32 ZPos)
+{
+	NonResidentReads++;
+	if (BorderPolicy == ESamplerBorderPolicy::Clamp && bHasClampChunk)
+	{
+		// This is normally still in the accessor's cache. If it has been evicted since, we fall back to the border.
+		FPagedChunkData* clampChunk = Accessor.GetChunk(ClampChunkPosition.X, ClampChunkPosition.Y, ClampChunkPosition.Z);
+		if (clampChunk != NULL)
+		{
+			const int32 xPos = FMath::Clamp(XPos - clampChunk->ChunkRegion.LowerX, 0, (int32)ChunkSideLengthMinusOne);
+			const int32 yPos = FMath::Clamp(YPos - clampChunk->ChunkRegion.LowerY, 0, (int32)ChunkSideLengthMinusOne);
+			const int32 zPos = FMath::Clamp(ZPos - clampChunk->ChunkRegion.LowerZ, 0, (int32)ChunkSideLengthMinusOne);
+			return clampChunk->GetVoxelByCoordinatesChunkSpace(xPos, yPos, zPos);
+		}
+	}
+	return BorderVoxel;
+}
+
+bool UVolumeSampler::IsResident() const
+{
+	return CurrentChunk != NULL || BorderPolicy == ESamplerBorderPolicy::PageIn;
+}
+
+int32 UVolumeSampler::GetNonResidentReads() const
+{
+	return NonResidentReads;
+}
+
+ESamplerBorderPolicy UVolumeSampler::GetBorderPolicy() const
+{
+	return BorderPolicy;
+}
+
+// Whether a step of Offset (-1, 0 or 1) from a position in a chunk stays inside that chunk.
+static FORCEINLINE bool CanPeek(int32 Offset, int32 PosInChunk, int32 SideLengthMinusOne)
+{
+	return Offset < 0 ? PosInChunk > 0 : (Offset > 0 ? PosInChunk < SideLengthMinusOne : true);
+}
+
+// How far that step moves the Morton index, from the delta table for its axis.
+static FORCEINLINE int32 GetPeekDelta(const std::array<int32, 256>& Deltas, int32 Offset, int32 PosInChunk)
+{
+	return Offset < 0 ? -Deltas[PosInChunk - 1] : (Offset > 0 ? Deltas[PosInChunk] : 0);
+}
+
+template <int32 XOffset, int32 YOffset, int32 ZOffset>
+FORCEINLINE FVoxel UVolumeSampler::PeekVoxel()
+{
+	if (CurrentVoxels != NULL &&
+		CanPeek(XOffset, XPosInChunk, ChunkSideLengthMinusOne) &&
+		CanPeek(YOffset, YPosInChunk, ChunkSideLengthMinusOne) &&
+		CanPeek(ZOffset, ZPosInChunk, ChunkSideLengthMinusOne))
+	{
+		return CurrentVoxels->GetUnchecked(CurrentVoxelIndex + GetPeekDelta(deltaX, XOffset, XPosInChunk) + GetPeekDelta(deltaY, YOffset, YPosInChunk) + GetPeekDelta(deltaZ, ZOffset, ZPosInChunk));
+	}
+	return PeekVoxelInOtherChunk(XOffset, YOffset, ZOffset);
+}
+
+FVoxel UVolumeSampler::PeekVoxelInOtherChunk(int32 XOffset, int32 YOffset, int32 ZOffset)
+{
+	const int32 xPos = XPosInVolume + XOffset;
+	const int32 yPos = YPosInVolume + YOffset;
+	const int32 zPos = ZPosInVolume + ZOffset;
+	const uint8 sideLengthPower = Volume->GetSideLengthPower();
+
+	// Neighbouring chunks always land in a different slot of the accessor's cache to the current one, so this never
+	// unpins CurrentChunk
+	FPagedChunkData* chunk = Accessor.GetChunk(xPos >> sideLengthPower, yPos >> sideLengthPower, zPos >> sideLengthPower);
+	if (chunk == NULL)
+	{
+		return GetNonResidentVoxel(xPos, yPos, zPos);
 	}
+	return chunk->GetVoxelByCoordinatesChunkSpace(xPos & ChunkSideLengthMinusOne, yPos & ChunkSideLengthMinusOne, zPos & ChunkSideLengthMinusOne);
+}
+
+FVoxel UVolumeSampler::PeekVoxel1nx1ny1nz()
+{
+	return PeekVoxel<-1, -1, -1>();
+}
+
+FVoxel UVolumeSampler::PeekVoxel1nx1ny0pz()
+{
+	return PeekVoxel<-1, -1, 0>();
+}
+
+FVoxel UVolumeSampler::PeekVoxel1nx1ny1pz()
+{
+	return PeekVoxel<-1, -1, 1>();
+}
+
+FVoxel UVolumeSampler::PeekVoxel1nx0py1nz()
+{
+	return PeekVoxel<-1, 0, -1>();
+}
+
+FVoxel UVolumeSampler::PeekVoxel1nx0py0pz()
+{
+	return PeekVoxel<-1, 0, 0>();
+}
+
+FVoxel UVolumeSampler::PeekVoxel1nx0py1pz()
+{
+	return PeekVoxel<-1, 0, 1>();
+}
+
+FVoxel UVolumeSampler::PeekVoxel1nx1py1nz()
+{
+	return PeekVoxel<-1, 1, -1>();
+}
+
+FVoxel UVolumeSampler::PeekVoxel1nx1py0pz()
+{
+	return PeekVoxel<-1, 1, 0>();
+}
+
+FVoxel UVolumeSampler::PeekVoxel1nx1py1pz()
+{
+	return PeekVoxel<-1, 1, 1>();
+}
+
+FVoxel UVolumeSampler::PeekVoxel0px1ny1nz()
+{
+	return PeekVoxel<0, -1, -1>();
+}
+
+FVoxel UVolumeSampler::PeekVoxel0px1ny0pz()
+{
+	return PeekVoxel<0, -1, 0>();
+}
+
+FVoxel UVolumeSampler::PeekVoxel0px1ny1pz()
+{
+	return PeekVoxel<0, -1, 1>();
+}
+
+FVoxel UVolumeSampler::PeekVoxel0px0py1nz()
+{
+	return PeekVoxel<0, 0, -1>();
+}
+
+FVoxel UVolumeSampler::PeekVoxel0px0py0pz()
+{
+	return GetVoxel();
+}
+
+FVoxel UVolumeSampler::PeekVoxel0px0py1pz()
+{
+	return PeekVoxel<0, 0, 1>();
+}
+
+FVoxel UVolumeSampler::PeekVoxel0px1py1nz()
+{
+	return PeekVoxel<0, 1, -1>();
+}
+
+FVoxel UVolumeSampler::PeekVoxel0px1py0pz()
+{
+	return PeekVoxel<0, 1, 0>();
+}
+
+FVoxel UVolumeSampler::PeekVoxel0px1py1pz()
+{
+	return PeekVoxel<0, 1, 1>();
+}
+
+FVoxel UVolumeSampler::PeekVoxel1px1ny1nz()
+{
+	return PeekVoxel<1, -1, -1>();
+}
+
+FVoxel UVolumeSampler::PeekVoxel1px1ny0pz()
+{
+	return PeekVoxel<1, -1, 0>();
+}
+
+FVoxel UVolumeSampler::PeekVoxel1px1ny1pz()
+{
+	return PeekVoxel<1, -1, 1>();
+}
+
+FVoxel UVolumeSampler::PeekVoxel1px0py1nz()
+{
+	return PeekVoxel<1, 0, -1>();
+}
+
+FVoxel UVolumeSampler::PeekVoxel1px0py0pz()
+{
+	return PeekVoxel<1, 0, 0>();
+}
+
+FVoxel UVolumeSampler::PeekVoxel1px0py1pz()
+{
+	return PeekVoxel<1, 0, 1>();
+}
+
+FVoxel UVolumeSampler::PeekVoxel1px1py1nz()
+{
+	return PeekVoxel<1, 1, -1>();
+}
+
+FVoxel UVolumeSampler::PeekVoxel1px1py0pz()
+{
+	return PeekVoxel<1, 1, 0>();
+}
+
+FVoxel UVolumeSampler::PeekVoxel1px1py1pz()
+{
+	return PeekVoxel<1, 1, 1>();
 }
 
 void UVolumeSampler::SetPosition(int32 XPos, int32 YPos, int32 ZPos)
@@ -111,13 +351,12 @@ void UVolumeSampler::SetPosition(int32 XPos, int32 YPos, int32 ZPos)
 
 		uint32 voxelIndexInChunk = morton256_x[XPosInChunk] | morton256_y[YPosInChunk] | morton256_z[ZPosInChunk];
 
-		if (Volume->CanReuseLastAccessedChunk(xChunk, yChunk, zChunk))
-		{
-			CurrentChunk = Volume->GetLastAccessedChunk();
-		}
-		else
+		CurrentChunk = Accessor.GetChunk(xChunk, yChunk, zChunk);
+		CurrentVoxels = CurrentChunk != NULL ? &CurrentChunk->VoxelData : NULL;
+		if (CurrentChunk != NULL && BorderPolicy == ESamplerBorderPolicy::Clamp)
 		{
-			CurrentChunk = Volume->GetChunk(xChunk, yChunk, zChunk);
+			bHasClampChunk = true;
+			ClampChunkPosition = FIntVector(xChunk, yChunk, zChunk);
 		}
 
 		CurrentVoxelIndex = voxelIndexInChunk;
@@ -24,28 +24,333 @@ SOFTWARE.
 *******************************************************************************/
 
 #include "PolyVoxPrivatePCH.h"
-#include "ArrayHelper.h"
 #include "DrawDebugHelpers.h"
 #include "VoxelProceduralMeshComponent.h"
 
 //#define DO_CHECK = 1
 
+const uint16 UVoxelProceduralMeshComponent::EdgeTable[256] =
+{
+	0x000, 0x109, 0x203, 0x30a, 0x80c, 0x905, 0xa0f, 0xb06,
+	0x406, 0x50f, 0x605, 0x70c, 0xc0a, 0xd03, 0xe09, 0xf00,
+	0x190, 0x099, 0x393, 0x29a, 0x99c, 0x895, 0xb9f, 0xa96,
+	0x596, 0x49f, 0x795, 0x69c, 0xd9a, 0xc93, 0xf99, 0xe90,
+	0x230, 0x339, 0x033, 0x13a, 0xa3c, 0xb35, 0x83f, 0x936,
+	0x636, 0x73f, 0x435, 0x53c, 0xe3a, 0xf33, 0xc39, 0xd30,
+	0x3a0, 0x2a9, 0x1a3, 0x0aa, 0xbac, 0xaa5, 0x9af, 0x8a6,
+	0x7a6, 0x6af, 0x5a5, 0x4ac, 0xfaa, 0xea3, 0xda9, 0xca0,
+	0x8c0, 0x9c9, 0xac3, 0xbca, 0x0cc, 0x1c5, 0x2cf, 0x3c6,
+	0xcc6, 0xdcf, 0xec5, 0xfcc, 0x4ca, 0x5c3, 0x6c9, 0x7c0,
+	0x950, 0x859, 0xb53, 0xa5a, 0x15c, 0x055, 0x35f, 0x256,
+	0xd56, 0xc5f, 0xf55, 0xe5c, 0x55a, 0x453, 0x759, 0x650,
+	0xaf0, 0xbf9, 0x8f3, 0x9fa, 0x2fc, 0x3f5, 0x0ff, 0x1f6,
+	0xef6, 0xfff, 0xcf5, 0xdfc, 0x6fa, 0x7f3, 0x4f9, 0x5f0,
+	0xb60, 0xa69, 0x963, 0x86a, 0x36c, 0x265, 0x16f, 0x066,
+	0xf66, 0xe6f, 0xd65, 0xc6c, 0x76a, 0x663, 0x569, 0x460,
+	0x460, 0x569, 0x663, 0x76a, 0xc6c, 0xd65, 0xe6f, 0xf66,
+	0x066, 0x16f, 0x265, 0x36c, 0x86a, 0x963, 0xa69, 0xb60,
+	0x5f0, 0x4f9, 0x7f3, 0x6fa, 0xdfc, 0xcf5, 0xfff, 0xef6,
+	0x1f6, 0x0ff, 0x3f5, 0x2fc, 0x9fa, 0x8f3, 0xbf9, 0xaf0,
+	0x650, 0x759, 0x453, 0x55a, 0xe5c, 0xf55, 0xc5f, 0xd56,
+	0x256, 0x35f, 0x055, 0x15c, 0xa5a, 0xb53, 0x859, 0x950,
+	0x7c0, 0x6c9, 0x5c3, 0x4ca, 0xfcc, 0xec5, 0xdcf, 0xcc6,
+	0x3c6, 0x2cf, 0x1c5, 0x0cc, 0xbca, 0xac3, 0x9c9, 0x8c0,
+	0xca0, 0xda9, 0xea3, 0xfaa, 0x4ac, 0x5a5, 0x6af, 0x7a6,
+	0x8a6, 0x9af, 0xaa5, 0xbac, 0x0aa, 0x1a3, 0x2a9, 0x3a0,
+	0xd30, 0xc39, 0xf33, 0xe3a, 0x53c, 0x435, 0x73f, 0x636,
+	0x936, 0x83f, 0xb35, 0xa3c, 0x13a, 0x033, 0x339, 0x230,
+	0xe90, 0xf99, 0xc93, 0xd9a, 0x69c, 0x795, 0x49f, 0x596,
+	0xa96, 0xb9f, 0x895, 0x99c, 0x29a, 0x393, 0x099, 0x190,
+	0xf00, 0xe09, 0xd03, 0xc0a, 0x70c, 0x605, 0x50f, 0x406,
+	0xb06, 0xa0f, 0x905, 0x80c, 0x30a, 0x203, 0x109, 0x000
+};
+
+const int8 UVoxelProceduralMeshComponent::TriTable[256][16] =
+{
+	{ -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, },
+	{ 0, 8, 3, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, },
+	{ 0, 1, 9, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, },
+	{ 1, 8, 3, 9, 8, 1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, },
+	{ 3, 11, 2, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, },
+	{ 0, 11, 2, 8, 11, 0, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, },
+	{ 1, 9, 0, 2, 3, 11, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, },
+	{ 1, 11, 2, 1, 9, 11, 9, 8, 11, -1, -1, -1, -1, -1, -1, -1, },
+	{ 1, 2, 10, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, },
+	{ 0, 8, 3, 1, 2, 10, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, },
+	{ 9, 2, 10, 0, 2, 9, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, },
+	{ 2, 8, 3, 2, 10, 8, 10, 9, 8, -1, -1, -1, -1, -1, -1, -1, },
+	{ 3, 10, 1, 11, 10, 3, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, },
+	{ 0, 10, 1, 0, 8, 10, 8, 11, 10, -1, -1, -1, -1, -1, -1, -1, },
+	{ 3, 9, 0, 3, 11, 9, 11, 10, 9, -1, -1, -1, -1, -1, -1, -1, },
+	{ 9, 8, 10, 10, 8, 11, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, },
+	{ 4, 7, 8, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, },
+	{ 4, 3, 0, 7, 3, 4, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, },
+	{ 0, 1, 9, 8, 4, 7, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, },
+	{ 4, 1, 9, 4, 7, 1, 7, 3, 1, -1, -1, -1, -1, -1, -1, -1, },
+	{ 8, 4, 7, 3, 11, 2, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, },
+	{ 11, 4, 7, 11, 2, 4, 2, 0, 4, -1, -1, -1, -1, -1, -1, -1, },
+	{ 9, 0, 1, 8, 4, 7, 2, 3, 11, -1, -1, -1, -1, -1, -1, -1, },
+	{ 4, 7, 11, 9, 4, 11, 9, 11, 2, 9, 2, 1, -1, -1, -1, -1, },
+	{ 1, 2, 10, 8, 4, 7, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, },
+	{ 3, 4, 7, 3, 0, 4, 1, 2, 10, -1, -1, -1, -1, -1, -1, -1, },
+	{ 9, 2, 10, 9, 0, 2, 8, 4, 7, -1, -1, -1, -1, -1, -1, -1, },
+	{ 2, 10, 9, 2, 9, 7, 2, 7, 3, 7, 9, 4, -1, -1, -1, -1, },
+	{ 3, 10, 1, 3, 11, 10, 7, 8, 4, -1, -1, -1, -1, -1, -1, -1, },
+	{ 1, 11, 10, 1, 4, 11, 1, 0, 4, 7, 11, 4, -1, -1, -1, -1, },
+	{ 4, 7, 8, 9, 0, 11, 9, 11, 10, 11, 0, 3, -1, -1, -1, -1, },
+	{ 4, 7, 11, 4, 11, 9, 9, 11, 10, -1, -1, -1, -1, -1, -1, -1, },
+	{ 9, 5, 4, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, },
+	{ 9, 5, 4, 0, 8, 3, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, },
+	{ 0, 5, 4, 1, 5, 0, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, },
+	{ 8, 5, 4, 8, 3, 5, 3, 1, 5, -1, -1, -1, -1, -1, -1, -1, },
+	{ 9, 5, 4, 2, 3, 11, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, },
+	{ 0, 11, 2, 0, 8, 11, 4, 9, 5, -1, -1, -1, -1, -1, -1, -1, },
+	{ 0, 5, 4, 0, 1, 5, 2, 3, 11, -1, -1, -1, -1, -1, -1, -1, },
+	{ 2, 1, 5, 2, 5, 8, 2, 8, 11, 4, 8, 5, -1, -1, -1, -1, },
+	{ 1, 2, 10, 9, 5, 4, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, },
+	{ 3, 0, 8, 1, 2, 10, 4, 9, 5, -1, -1, -1, -1, -1, -1, -1, },
+	{ 5, 2, 10, 5, 4, 2, 4, 0, 2, -1, -1, -1, -1, -1, -1, -1, },
+	{ 2, 10, 5, 3, 2, 5, 3, 5, 4, 3, 4, 8, -1, -1, -1, -1, },
+	{ 10, 3, 11, 10, 1, 3, 9, 5, 4, -1, -1, -1, -1, -1, -1, -1, },
+	{ 4, 9, 5, 0, 8, 1, 8, 10, 1, 8, 11, 10, -1, -1, -1, -1, },
+	{ 5, 4, 0, 5, 0, 11, 5, 11, 10, 11, 0, 3, -1, -1, -1, -1, },
+	{ 5, 4, 8, 5, 8, 10, 10, 8, 11, -1, -1, -1, -1, -1, -1, -1, },
+	{ 9, 7, 8, 5, 7, 9, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, },
+	{ 9, 3, 0, 9, 5, 3, 5, 7, 3, -1, -1, -1, -1, -1, -1, -1, },
+	{ 0, 7, 8, 0, 1, 7, 1, 5, 7, -1, -1, -1, -1, -1, -1, -1, },
+	{ 1, 5, 3, 3, 5, 7, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, },
+	{ 7, 9, 5, 7, 8, 9, 3, 11, 2, -1, -1, -1, -1, -1, -1, -1, },
+	{ 9, 5, 7, 9, 7, 2, 9, 2, 0, 2, 7, 11, -1, -1, -1, -1, },
+	{ 2, 3, 11, 0, 1, 8, 1, 7, 8, 1, 5, 7, -1, -1, -1, -1, },
+	{ 11, 2, 1, 11, 1, 7, 7, 1, 5, -1, -1, -1, -1, -1, -1, -1, },
+	{ 9, 7, 8, 9, 5, 7, 10, 1, 2, -1, -1, -1, -1, -1, -1, -1, },
+	{ 10, 1, 2, 9, 5, 0, 5, 3, 0, 5, 7, 3, -1, -1, -1, -1, },
+	{ 8, 0, 2, 8, 2, 5, 8, 5, 7, 10, 5, 2, -1, -1, -1, -1, },
+	{ 2, 10, 5, 2, 5, 3, 3, 5, 7, -1, -1, -1, -1, -1, -1, -1, },
+	{ 9, 5, 8, 8, 5, 7, 10, 1, 3, 10, 3, 11, -1, -1, -1, -1, },
+	{ 5, 7, 0, 5, 0, 9, 7, 11, 0, 1, 0, 10, 11, 10, 0, -1, },
+	{ 11, 10, 0, 11, 0, 3, 10, 5, 0, 8, 0, 7, 5, 7, 0, -1, },
+	{ 11, 10, 5, 7, 11, 5, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, },
+	{ 7, 6, 11, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, },
+	{ 3, 0, 8, 11, 7, 6, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, },
+	{ 0, 1, 9, 11, 7, 6, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, },
+	{ 8, 1, 9, 8, 3, 1, 11, 7, 6, -1, -1, -1, -1, -1, -1, -1, },
+	{ 7, 2, 3, 6, 2, 7, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, },
+	{ 7, 0, 8, 7, 6, 0, 6, 2, 0, -1, -1, -1, -1, -1, -1, -1, },
+	{ 2, 7, 6, 2, 3, 7, 0, 1, 9, -1, -1, -1, -1, -1, -1, -1, },
+	{ 1, 6, 2, 1, 8, 6, 1, 9, 8, 8, 7, 6, -1, -1, -1, -1, },
+	{ 10, 1, 2, 6, 11, 7, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, },
+	{ 1, 2, 10, 3, 0, 8, 6, 11, 7, -1, -1, -1, -1, -1, -1, -1, },
+	{ 2, 9, 0, 2, 10, 9, 6, 11, 7, -1, -1, -1, -1, -1, -1, -1, },
+	{ 6, 11, 7, 2, 10, 3, 10, 8, 3, 10, 9, 8, -1, -1, -1, -1, },
+	{ 10, 7, 6, 10, 1, 7, 1, 3, 7, -1, -1, -1, -1, -1, -1, -1, },
+	{ 10, 7, 6, 1, 7, 10, 1, 8, 7, 1, 0, 8, -1, -1, -1, -1, },
+	{ 0, 3, 7, 0, 7, 10, 0, 10, 9, 6, 10, 7, -1, -1, -1, -1, },
+	{ 7, 6, 10, 7, 10, 8, 8, 10, 9, -1, -1, -1, -1, -1, -1, -1, },
+	{ 6, 8, 4, 11, 8, 6, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, },
+	{ 3, 6, 11, 3, 0, 6, 0, 4, 6, -1, -1, -1, -1, -1, -1, -1, },
+	{ 8, 6, 11, 8, 4, 6, 9, 0, 1, -1, -1, -1, -1, -1, -1, -1, },
+	{ 9, 4, 6, 9, 6, 3, 9, 3, 1, 11, 3, 6, -1, -1, -1, -1, },
+	{ 8, 2, 3, 8, 4, 2, 4, 6, 2, -1, -1, -1, -1, -1, -1, -1, },
+	{ 0, 4, 2, 4, 6, 2, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, },
+	{ 1, 9, 0, 2, 3, 4, 2, 4, 6, 4, 3, 8, -1, -1, -1, -1, },
+	{ 1, 9, 4, 1, 4, 2, 2, 4, 6, -1, -1, -1, -1, -1, -1, -1, },
+	{ 6, 8, 4, 6, 11, 8, 2, 10, 1, -1, -1, -1, -1, -1, -1, -1, },
+	{ 1, 2, 10, 3, 0, 11, 0, 6, 11, 0, 4, 6, -1, -1, -1, -1, },
+	{ 4, 11, 8, 4, 6, 11, 0, 2, 9, 2, 10, 9, -1, -1, -1, -1, },
+	{ 10, 9, 3, 10, 3, 2, 9, 4, 3, 11, 3, 6, 4, 6, 3, -1, },
+	{ 8, 1, 3, 8, 6, 1, 8, 4, 6, 6, 10, 1, -1, -1, -1, -1, },
+	{ 10, 1, 0, 10, 0, 6, 6, 0, 4, -1, -1, -1, -1, -1, -1, -1, },
+	{ 4, 6, 3, 4, 3, 8, 6, 10, 3, 0, 3, 9, 10, 9, 3, -1, },
+	{ 10, 9, 4, 6, 10, 4, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, },
+	{ 4, 9, 5, 7, 6, 11, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, },
+	{ 0, 8, 3, 4, 9, 5, 11, 7, 6, -1, -1, -1, -1, -1, -1, -1, },
+	{ 5, 0, 1, 5, 4, 0, 7, 6, 11, -1, -1, -1, -1, -1, -1, -1, },
+	{ 11, 7, 6, 8, 3, 4, 3, 5, 4, 3, 1, 5, -1, -1, -1, -1, },
+	{ 7, 2, 3, 7, 6, 2, 5, 4, 9, -1, -1, -1, -1, -1, -1, -1, },
+	{ 9, 5, 4, 0, 8, 6, 0, 6, 2, 6, 8, 7, -1, -1, -1, -1, },
+	{ 3, 6, 2, 3, 7, 6, 1, 5, 0, 5, 4, 0, -1, -1, -1, -1, },
+	{ 6, 2, 8, 6, 8, 7, 2, 1, 8, 4, 8, 5, 1, 5, 8, -1, },
+	{ 9, 5, 4, 10, 1, 2, 7, 6, 11, -1, -1, -1, -1, -1, -1, -1, },
+	{ 6, 11, 7, 1, 2, 10, 0, 8, 3, 4, 9, 5, -1, -1, -1, -1, },
+	{ 7, 6, 11, 5, 4, 10, 4, 2, 10, 4, 0, 2, -1, -1, -1, -1, },
+	{ 3, 4, 8, 3, 5, 4, 3, 2, 5, 10, 5, 2, 11, 7, 6, -1, },
+	{ 9, 5, 4, 10, 1, 6, 1, 7, 6, 1, 3, 7, -1, -1, -1, -1, },
+	{ 1, 6, 10, 1, 7, 6, 1, 0, 7, 8, 7, 0, 9, 5, 4, -1, },
+	{ 4, 0, 10, 4, 10, 5, 0, 3, 10, 6, 10, 7, 3, 7, 10, -1, },
+	{ 7, 6, 10, 7, 10, 8, 5, 4, 10, 4, 8, 10, -1, -1, -1, -1, },
+	{ 6, 9, 5, 6, 11, 9, 11, 8, 9, -1, -1, -1, -1, -1, -1, -1, },
+	{ 3, 6, 11, 0, 6, 3, 0, 5, 6, 0, 9, 5, -1, -1, -1, -1, },
+	{ 0, 11, 8, 0, 5, 11, 0, 1, 5, 5, 6, 11, -1, -1, -1, -1, },
+	{ 6, 11, 3, 6, 3, 5, 5, 3, 1, -1, -1, -1, -1, -1, -1, -1, },
+	{ 5, 8, 9, 5, 2, 8, 5, 6, 2, 3, 8, 2, -1, -1, -1, -1, },
+	{ 9, 5, 6, 9, 6, 0, 0, 6, 2, -1, -1, -1, -1, -1, -1, -1, },
+	{ 1, 5, 8, 1, 8, 0, 5, 6, 8, 3, 8, 2, 6, 2, 8, -1, },
+	{ 1, 5, 6, 2, 1, 6, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, },
+	{ 1, 2, 10, 9, 5, 11, 9, 11, 8, 11, 5, 6, -1, -1, -1, -1, },
+	{ 0, 11, 3, 0, 6, 11, 0, 9, 6, 5, 6, 9, 1, 2, 10, -1, },
+	{ 11, 8, 5, 11, 5, 6, 8, 0, 5, 10, 5, 2, 0, 2, 5, -1, },
+	{ 6, 11, 3, 6, 3, 5, 2, 10, 3, 10, 5, 3, -1, -1, -1, -1, },
+	{ 1, 3, 6, 1, 6, 10, 3, 8, 6, 5, 6, 9, 8, 9, 6, -1, },
+	{ 10, 1, 0, 10, 0, 6, 9, 5, 0, 5, 6, 0, -1, -1, -1, -1, },
+	{ 0, 3, 8, 5, 6, 10, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, },
+	{ 10, 5, 6, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, },
+	{ 10, 6, 5, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, },
+	{ 0, 8, 3, 5, 10, 6, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, },
+	{ 9, 0, 1, 5, 10, 6, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, },
+	{ 1, 8, 3, 1, 9, 8, 5, 10, 6, -1, -1, -1, -1, -1, -1, -1, },
+	{ 2, 3, 11, 10, 6, 5, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, },
+	{ 11, 0, 8, 11, 2, 0, 10, 6, 5, -1, -1, -1, -1, -1, -1, -1, },
+	{ 0, 1, 9, 2, 3, 11, 5, 10, 6, -1, -1, -1, -1, -1, -1, -1, },
+	{ 5, 10, 6, 1, 9, 2, 9, 11, 2, 9, 8, 11, -1, -1, -1, -1, },
+	{ 1, 6, 5, 2, 6, 1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, },
+	{ 1, 6, 5, 1, 2, 6, 3, 0, 8, -1, -1, -1, -1, -1, -1, -1, },
+	{ 9, 6, 5, 9, 0, 6, 0, 2, 6, -1, -1, -1, -1, -1, -1, -1, },
+	{ 5, 9, 8, 5, 8, 2, 5, 2, 6, 3, 2, 8, -1, -1, -1, -1, },
+	{ 6, 3, 11, 6, 5, 3, 5, 1, 3, -1, -1, -1, -1, -1, -1, -1, },
+	{ 0, 8, 11, 0, 11, 5, 0, 5, 1, 5, 11, 6, -1, -1, -1, -1, },
+	{ 3, 11, 6, 0, 3, 6, 0, 6, 5, 0, 5, 9, -1, -1, -1, -1, },
+	{ 6, 5, 9, 6, 9, 11, 11, 9, 8, -1, -1, -1, -1, -1, -1, -1, },
+	{ 5, 10, 6, 4, 7, 8, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, },
+	{ 4, 3, 0, 4, 7, 3, 6, 5, 10, -1, -1, -1, -1, -1, -1, -1, },
+	{ 1, 9, 0, 5, 10, 6, 8, 4, 7, -1, -1, -1, -1, -1, -1, -1, },
+	{ 10, 6, 5, 1, 9, 7, 1, 7, 3, 7, 9, 4, -1, -1, -1, -1, },
+	{ 3, 11, 2, 7, 8, 4, 10, 6, 5, -1, -1, -1, -1, -1, -1, -1, },
+	{ 5, 10, 6, 4, 7, 2, 4, 2, 0, 2, 7, 11, -1, -1, -1, -1, },
+	{ 0, 1, 9, 4, 7, 8, 2, 3, 11, 5, 10, 6, -1, -1, -1, -1, },
+	{ 9, 2, 1, 9, 11, 2, 9, 4, 11, 7, 11, 4, 5, 10, 6, -1, },
+	{ 6, 1, 2, 6, 5, 1, 4, 7, 8, -1, -1, -1, -1, -1, -1, -1, },
+	{ 1, 2, 5, 5, 2, 6, 3, 0, 4, 3, 4, 7, -1, -1, -1, -1, },
+	{ 8, 4, 7, 9, 0, 5, 0, 6, 5, 0, 2, 6, -1, -1, -1, -1, },
+	{ 7, 3, 9, 7, 9, 4, 3, 2, 9, 5, 9, 6, 2, 6, 9, -1, },
+	{ 8, 4, 7, 3, 11, 5, 3, 5, 1, 5, 11, 6, -1, -1, -1, -1, },
+	{ 5, 1, 11, 5, 11, 6, 1, 0, 11, 7, 11, 4, 0, 4, 11, -1, },
+	{ 0, 5, 9, 0, 6, 5, 0, 3, 6, 11, 6, 3, 8, 4, 7, -1, },
+	{ 6, 5, 9, 6, 9, 11, 4, 7, 9, 7, 11, 9, -1, -1, -1, -1, },
+	{ 10, 4, 9, 6, 4, 10, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, },
+	{ 4, 10, 6, 4, 9, 10, 0, 8, 3, -1, -1, -1, -1, -1, -1, -1, },
+	{ 10, 0, 1, 10, 6, 0, 6, 4, 0, -1, -1, -1, -1, -1, -1, -1, },
+	{ 8, 3, 1, 8, 1, 6, 8, 6, 4, 6, 1, 10, -1, -1, -1, -1, },
+	{ 10, 4, 9, 10, 6, 4, 11, 2, 3, -1, -1, -1, -1, -1, -1, -1, },
+	{ 0, 8, 2, 2, 8, 11, 4, 9, 10, 4, 10, 6, -1, -1, -1, -1, },
+	{ 3, 11, 2, 0, 1, 6, 0, 6, 4, 6, 1, 10, -1, -1, -1, -1, },
+	{ 6, 4, 1, 6, 1, 10, 4, 8, 1, 2, 1, 11, 8, 11, 1, -1, },
+	{ 1, 4, 9, 1, 2, 4, 2, 6, 4, -1, -1, -1, -1, -1, -1, -1, },
+	{ 3, 0, 8, 1, 2, 9, 2, 4, 9, 2, 6, 4, -1, -1, -1, -1, },
+	{ 0, 2, 4, 4, 2, 6, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, },
+	{ 8, 3, 2, 8, 2, 4, 4, 2, 6, -1, -1, -1, -1, -1, -1, -1, },
+	{ 9, 6, 4, 9, 3, 6, 9, 1, 3, 11, 6, 3, -1, -1, -1, -1, },
+	{ 8, 11, 1, 8, 1, 0, 11, 6, 1, 9, 1, 4, 6, 4, 1, -1, },
+	{ 3, 11, 6, 3, 6, 0, 0, 6, 4, -1, -1, -1, -1, -1, -1, -1, },
+	{ 6, 4, 8, 11, 6, 8, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, },
+	{ 7, 10, 6, 7, 8, 10, 8, 9, 10, -1, -1, -1, -1, -1, -1, -1, },
+	{ 0, 7, 3, 0, 10, 7, 0, 9, 10, 6, 7, 10, -1, -1, -1, -1, },
+	{ 10, 6, 7, 1, 10, 7, 1, 7, 8, 1, 8, 0, -1, -1, -1, -1, },
+	{ 10, 6, 7, 10, 7, 1, 1, 7, 3, -1, -1, -1, -1, -1, -1, -1, },
+	{ 2, 3, 11, 10, 6, 8, 10, 8, 9, 8, 6, 7, -1, -1, -1, -1, },
+	{ 2, 0, 7, 2, 7, 11, 0, 9, 7, 6, 7, 10, 9, 10, 7, -1, },
+	{ 1, 8, 0, 1, 7, 8, 1, 10, 7, 6, 7, 10, 2, 3, 11, -1, },
+	{ 11, 2, 1, 11, 1, 7, 10, 6, 1, 6, 7, 1, -1, -1, -1, -1, },
+	{ 1, 2, 6, 1, 6, 8, 1, 8, 9, 8, 6, 7, -1, -1, -1, -1, },
+	{ 2, 6, 9, 2, 9, 1, 6, 7, 9, 0, 9, 3, 7, 3, 9, -1, },
+	{ 7, 8, 0, 7, 0, 6, 6, 0, 2, -1, -1, -1, -1, -1, -1, -1, },
+	{ 7, 3, 2, 6, 7, 2, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, },
+	{ 8, 9, 6, 8, 6, 7, 9, 1, 6, 11, 6, 3, 1, 3, 6, -1, },
+	{ 0, 9, 1, 11, 6, 7, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, },
+	{ 7, 8, 0, 7, 0, 6, 3, 11, 0, 11, 6, 0, -1, -1, -1, -1, },
+	{ 7, 11, 6, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, },
+	{ 11, 5, 10, 7, 5, 11, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, },
+	{ 11, 5, 10, 11, 7, 5, 8, 3, 0, -1, -1, -1, -1, -1, -1, -1, },
+	{ 5, 11, 7, 5, 10, 11, 1, 9, 0, -1, -1, -1, -1, -1, -1, -1, },
+	{ 10, 7, 5, 10, 11, 7, 9, 8, 1, 8, 3, 1, -1, -1, -1, -1, },
+	{ 2, 5, 10, 2, 3, 5, 3, 7, 5, -1, -1, -1, -1, -1, -1, -1, },
+	{ 8, 2, 0, 8, 5, 2, 8, 7, 5, 10, 2, 5, -1, -1, -1, -1, },
+	{ 9, 0, 1, 5, 10, 3, 5, 3, 7, 3, 10, 2, -1, -1, -1, -1, },
+	{ 9, 8, 2, 9, 2, 1, 8, 7, 2, 10, 2, 5, 7, 5, 2, -1, },
+	{ 11, 1, 2, 11, 7, 1, 7, 5, 1, -1, -1, -1, -1, -1, -1, -1, },
+	{ 0, 8, 3, 1, 2, 7, 1, 7, 5, 7, 2, 11, -1, -1, -1, -1, },
+	{ 9, 7, 5, 9, 2, 7, 9, 0, 2, 2, 11, 7, -1, -1, -1, -1, },
+	{ 7, 5, 2, 7, 2, 11, 5, 9, 2, 3, 2, 8, 9, 8, 2, -1, },
+	{ 1, 3, 5, 3, 7, 5, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, },
+	{ 0, 8, 7, 0, 7, 1, 1, 7, 5, -1, -1, -1, -1, -1, -1, -1, },
+	{ 9, 0, 3, 9, 3, 5, 5, 3, 7, -1, -1, -1, -1, -1, -1, -1, },
+	{ 9, 8, 7, 5, 9, 7, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, },
+	{ 5, 8, 4, 5, 10, 8, 10, 11, 8, -1, -1, -1, -1, -1, -1, -1, },
+	{ 5, 0, 4, 5, 11, 0, 5, 10, 11, 11, 3, 0, -1, -1, -1, -1, },
+	{ 0, 1, 9, 8, 4, 10, 8, 10, 11, 10, 4, 5, -1, -1, -1, -1, },
+	{ 10, 11, 4, 10, 4, 5, 11, 3, 4, 9, 4, 1, 3, 1, 4, -1, },
+	{ 2, 5, 10, 3, 5, 2, 3, 4, 5, 3, 8, 4, -1, -1, -1, -1, },
+	{ 5, 10, 2, 5, 2, 4, 4, 2, 0, -1, -1, -1, -1, -1, -1, -1, },
+	{ 3, 10, 2, 3, 5, 10, 3, 8, 5, 4, 5, 8, 0, 1, 9, -1, },
+	{ 5, 10, 2, 5, 2, 4, 1, 9, 2, 9, 4, 2, -1, -1, -1, -1, },
+	{ 2, 5, 1, 2, 8, 5, 2, 11, 8, 4, 5, 8, -1, -1, -1, -1, },
+	{ 0, 4, 11, 0, 11, 3, 4, 5, 11, 2, 11, 1, 5, 1, 11, -1, },
+	{ 0, 2, 5, 0, 5, 9, 2, 11, 5, 4, 5, 8, 11, 8, 5, -1, },
+	{ 9, 4, 5, 2, 11, 3, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, },
+	{ 8, 4, 5, 8, 5, 3, 3, 5, 1, -1, -1, -1, -1, -1, -1, -1, },
+	{ 0, 4, 5, 1, 0, 5, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, },
+	{ 8, 4, 5, 8, 5, 3, 9, 0, 5, 0, 3, 5, -1, -1, -1, -1, },
+	{ 9, 4, 5, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, },
+	{ 4, 11, 7, 4, 9, 11, 9, 10, 11, -1, -1, -1, -1, -1, -1, -1, },
+	{ 0, 8, 3, 4, 9, 7, 9, 11, 7, 9, 10, 11, -1, -1, -1, -1, },
+	{ 1, 10, 11, 1, 11, 4, 1, 4, 0, 7, 4, 11, -1, -1, -1, -1, },
+	{ 3, 1, 4, 3, 4, 8, 1, 10, 4, 7, 4, 11, 10, 11, 4, -1, },
+	{ 2, 9, 10, 2, 7, 9, 2, 3, 7, 7, 4, 9, -1, -1, -1, -1, },
+	{ 9, 10, 7, 9, 7, 4, 10, 2, 7, 8, 7, 0, 2, 0, 7, -1, },
+	{ 3, 7, 10, 3, 10, 2, 7, 4, 10, 1, 10, 0, 4, 0, 10, -1, },
+	{ 1, 10, 2, 8, 7, 4, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, },
+	{ 4, 11, 7, 9, 11, 4, 9, 2, 11, 9, 1, 2, -1, -1, -1, -1, },
+	{ 9, 7, 4, 9, 11, 7, 9, 1, 11, 2, 11, 1, 0, 8, 3, -1, },
+	{ 11, 7, 4, 11, 4, 2, 2, 4, 0, -1, -1, -1, -1, -1, -1, -1, },
+	{ 11, 7, 4, 11, 4, 2, 8, 3, 4, 3, 2, 4, -1, -1, -1, -1, },
+	{ 4, 9, 1, 4, 1, 7, 7, 1, 3, -1, -1, -1, -1, -1, -1, -1, },
+	{ 4, 9, 1, 4, 1, 7, 0, 8, 1, 8, 7, 1, -1, -1, -1, -1, },
+	{ 4, 0, 3, 7, 4, 3, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, },
+	{ 4, 8, 7, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, },
+	{ 9, 10, 8, 10, 11, 8, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, },
+	{ 3, 0, 9, 3, 9, 11, 11, 9, 10, -1, -1, -1, -1, -1, -1, -1, },
+	{ 0, 1, 10, 0, 10, 8, 8, 10, 11, -1, -1, -1, -1, -1, -1, -1, },
+	{ 3, 1, 10, 11, 3, 10, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, },
+	{ 2, 3, 8, 2, 8, 10, 10, 8, 9, -1, -1, -1, -1, -1, -1, -1, },
+	{ 9, 10, 2, 0, 9, 2, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, },
+	{ 2, 3, 8, 2, 8, 10, 0, 1, 8, 1, 10, 8, -1, -1, -1, -1, },
+	{ 1, 10, 2, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, },
+	{ 1, 2, 11, 1, 11, 9, 9, 11, 8, -1, -1, -1, -1, -1, -1, -1, },
+	{ 3, 0, 9, 3, 9, 11, 1, 2, 9, 2, 11, 9, -1, -1, -1, -1, },
+	{ 0, 2, 11, 8, 0, 11, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, },
+	{ 3, 2, 11, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, },
+	{ 1, 3, 8, 9, 1, 8, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, },
+	{ 0, 9, 1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, },
+	{ 0, 3, 8, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, },
+	{ -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, }
+};
+
 void UVoxelProceduralMeshComponent::CreateMarchingCubesMesh(UPagedVolumeComponent* VolumeData, FRegion Region, const TArray<FVoxelMaterial>& VoxelMaterials)
 {
-	auto rawMesh = GetEncodedMesh(VolumeData, Region, UMarchingCubesDefaultController::StaticClass());
-	TArray<FVoxelMeshSection> meshSections = GenerateTriangles(rawMesh);
-	if (meshSections.Num() > VoxelMaterials.Num())
+	SetMeshSections(ExtractMarchingCubesMesh(VolumeData, Region), VoxelMaterials);
+}
+
+TArray<FVoxelMeshSection> UVoxelProceduralMeshComponent::ExtractMarchingCubesMesh(UPagedVolumeComponent* VolumeData, FRegion Region, ESamplerBorderPolicy BorderPolicy /*= ESamplerBorderPolicy::PageIn*/)
+{
+	auto rawMesh = GetEncodedMesh(VolumeData, Region, UMarchingCubesDefaultController::StaticClass(), BorderPolicy, GetThreadScratch());
+	return GenerateTriangles(rawMesh);
+}
+
+void UVoxelProceduralMeshComponent::SetMeshSections(const TArray<FVoxelMeshSection>& MeshSections, const TArray<FVoxelMaterial>& VoxelMaterials)
+{
+	if (MeshSections.Num() > VoxelMaterials.Num())
 	{
-		UE_LOG(LogPolyVox, Warning, TEXT("More mesh sections are being made (%d) than there are materials defined (%d)."), meshSections.Num(), VoxelMaterials.Num());
+		UE_LOG(LogPolyVox, Warning, TEXT("More mesh sections are being made (%d) than there are materials defined (%d)."), MeshSections.Num(), VoxelMaterials.Num());
 		return;
 	}
-	else if (meshSections.Num() == 0)
+	else if (MeshSections.Num() == 0)
 	{
+		ClearAllMeshSections();
 		return;
 	}
-	for (int i = 0; i < meshSections.Num(); i++)
+	for (int i = 0; i < MeshSections.Num(); i++)
 	{
-		FProcMeshSection meshSection = CreateMeshSectionData(meshSections[i].Triangles, VoxelMaterials[i].bShouldCreateCollision, VoxelSize);
+		FProcMeshSection meshSection = CreateMeshSectionData(MeshSections[i].Triangles, VoxelMaterials[i].bShouldCreateCollision, VoxelSize);
 		SetProcMeshSection(i, meshSection);
 		if (VoxelMaterials.Num() > i)
 		{
@@ -56,15 +361,19 @@ void UVoxelProceduralMeshComponent::CreateMarchingCubesMesh(UPagedVolumeComponen
 			SetMaterial(i, VoxelMaterials[0].Material);
 		}
 	}
+	// Materials which have been dug away entirely
+	for (int i = MeshSections.Num(); i < GetNumSections(); i++)
+	{
+		ClearMeshSection(i);
+	}
 }
 
-FVoxelMesh UVoxelProceduralMeshComponent::AddVertex(FVoxelMesh& VoxelMesh, const FVoxelVertex& Vertex)
+int32 UVoxelProceduralMeshComponent::AddVertex(FVoxelMesh& VoxelMesh, const FVoxelVertex& Vertex)
 {
-	VoxelMesh.Vertices.Add(Vertex);
-	return VoxelMesh;
+	return VoxelMesh.Vertices.Add(Vertex);
 }
 
-FVoxelMesh UVoxelProceduralMeshComponent::AddTriangle(FVoxelMesh& VoxelMesh, const int32& Index0, const int32& Index1, const int32& Index2)
+void UVoxelProceduralMeshComponent::AddTriangle(FVoxelMesh& VoxelMesh, const int32& Index0, const int32& Index1, const int32& Index2)
 {
 	checkf(Index0 < VoxelMesh.Vertices.Num(), TEXT("Index points at an invalid vertex."));
 	checkf(Index1 < VoxelMesh.Vertices.Num(), TEXT("Index points at an invalid vertex."));
@@ -73,8 +382,6 @@ FVoxelMesh UVoxelProceduralMeshComponent::AddTriangle(FVoxelMesh& VoxelMesh, con
 	VoxelMesh.Indices.Add(Index0);
 	VoxelMesh.Indices.Add(Index1);
 	VoxelMesh.Indices.Add(Index2);
-
-	return VoxelMesh;
 }
 
 FProcMeshSection UVoxelProceduralMeshComponent::CreateMeshSectionData(TArray<FVoxelTriangle> Triangles, bool bShouldEnableCollision, float VoxelSize)
@@ -138,19 +445,60 @@ FProcMeshSection UVoxelProceduralMeshComponent::CreateMeshSectionData(TArray<FVo
 	return meshSection;
 }
 
-FVoxelMesh UVoxelProceduralMeshComponent::GetEncodedMesh(UPagedVolumeComponent* Volume, FRegion Region, TSubclassOf<UMarchingCubesDefaultController> Controller)
+// Whether a run of cells is entirely above the threshold, entirely below it, or might have a surface in it
+static const uint8 SPAN_ABOVE_THRESHOLD = 0;
+static const uint8 SPAN_BELOW_THRESHOLD = 1;
+static const uint8 SPAN_MIXED = 2;
+
+void FMarchingCubesScratch::Reset(int32 WidthInVoxels, int32 HeightInVoxels, int32 BricksWide, int32 NumBricks)
+{
+	const int32 sliceSize = WidthInVoxels * HeightInVoxels;
+	PreviousRowCellIndices.SetNumUninitialized(WidthInVoxels, false);
+	PreviousSliceCellIndices.SetNumUninitialized(sliceSize, false);
+	IndexSlabs[0].SetNumUninitialized(sliceSize * 3, false);
+	IndexSlabs[1].SetNumUninitialized(sliceSize * 3, false);
+	BrickOccupancy.SetNumUninitialized(NumBricks, false);
+	RowBrickStates.SetNumUninitialized(BricksWide, false);
+}
+
+FMarchingCubesScratch& UVoxelProceduralMeshComponent::GetThreadScratch()
+{
+	// Meshes are extracted on whichever thread asks for them, so every thread gets its own scratch space. These are
+	// never freed, but there are only ever a handful of threads and each one holds a few slices' worth of memory.
+	static const uint32 scratchTlsSlot = FPlatformTLS::AllocTlsSlot();
+	FMarchingCubesScratch* scratch = (FMarchingCubesScratch*)FPlatformTLS::GetTlsValue(scratchTlsSlot);
+	if (scratch == NULL)
+	{
+		scratch = new FMarchingCubesScratch();
+		FPlatformTLS::SetTlsValue(scratchTlsSlot, scratch);
+	}
+	return *scratch;
+}
+
+FVoxelMesh UVoxelProceduralMeshComponent::GetEncodedMesh(UPagedVolumeComponent* Volume, FRegion Region, TSubclassOf<UMarchingCubesDefaultController> Controller, ESamplerBorderPolicy BorderPolicy, FMarchingCubesScratch& Scratch)
 {
 	// Validate parameters
 	checkf(Volume != NULL, TEXT("Provided volume cannot be null"));
 	checkf(Controller != NULL, TEXT("Controller type must be provided."));
 	FVoxelMesh result;
 
+	// The default controller only cares about solidity, so if everything we would sample is uniformly solid or empty
+	// there can't be a surface anywhere in this region.
+	const bool bPageIn = BorderPolicy == ESamplerBorderPolicy::PageIn;
+	if (Volume->IsRegionUniformlySolidOrEmpty(Region, bPageIn))
+	{
+		return result;
+	}
+
 	UMarchingCubesDefaultController* controller = NewObject<UMarchingCubesDefaultController>((UObject*)GetTransientPackage(),Controller);
 
 	// Store some commonly used values for performance and convenience
 	const uint32 uRegionWidthInVoxels = (uint32)URegionHelper::GetWidthInVoxels(Region);
 	const uint32 uRegionHeightInVoxels = (uint32)URegionHelper::GetHeightInVoxels(Region);
 	const uint32 uRegionDepthInVoxels = (uint32)URegionHelper::GetDepthInVoxels(Region);
+	const int32 iRegionLowerX = URegionHelper::GetLowerX(Region);
+	const int32 iRegionLowerY = URegionHelper::GetLowerY(Region);
+	const int32 iRegionLowerZ = URegionHelper::GetLowerZ(Region);
 
 	auto Threshold = controller->GetThreshold();
 
@@ -159,36 +507,130 @@ FVoxelMesh UVoxelProceduralMeshComponent::GetEncodedMesh(UPagedVolumeComponent*
 	// cells, and so we can obtain these by careful bit-shifting. These variables keep track of previous cells for this purpose.
 	// We don't clear the arrays because the algorithm ensures that we only read from elements we have previously written to.
 	uint8 uPreviousCellIndex = 0;
-	TArray<uint8> pPreviousRowCellIndices;
-	pPreviousRowCellIndices.SetNumUninitialized(uRegionWidthInVoxels);
-	TArray<uint8> pPreviousSliceCellIndices;
-	pPreviousSliceCellIndices.AddUninitialized(uRegionWidthInVoxels * uRegionHeightInVoxels);
+	uint8* pPreviousRowCellIndices;
+	uint8* pPreviousSliceCellIndices;
 
 	// A given vertex may be shared by multiple triangles, so we need to keep track of the indices into the vertex array.
-	// We don't clear the arrays because the algorithm ensures that we only read from elements we have previously written to.
-	TArray<FVector> pIndices;
-	pIndices.SetNumUninitialized(uRegionWidthInVoxels * uRegionHeightInVoxels);
-	TArray<FVector> pPreviousIndices;
-	pPreviousIndices.SetNumUninitialized(uRegionWidthInVoxels * uRegionHeightInVoxels);
+	// Each voxel has three entries, for the vertices on the X, Y and Z edges leading into it, and the two slabs get
+	// swapped after each slice. We don't clear these either, for the same reason as above.
+	int32* pIndices;
+	int32* pPreviousIndices;
+	const uint32 uIndexRowStride = uRegionWidthInVoxels * 3;
+
+	// Look up the occupancy of every brick the region touches up front. Cells whose v111 voxel lies in a brick that
+	// is entirely solid or entirely air already know their last index bit, so the voxel only needs to be fetched if
+	// that cell turns out to have a surface in it.
+	const uint8 uBrickSideLengthPower = Volume->GetBrickSideLengthPower();
+	const int32 iLowerBrickX = iRegionLowerX >> uBrickSideLengthPower;
+	const int32 iLowerBrickY = iRegionLowerY >> uBrickSideLengthPower;
+	const int32 iLowerBrickZ = iRegionLowerZ >> uBrickSideLengthPower;
+	const int32 iBricksWide = (URegionHelper::GetUpperX(Region) >> uBrickSideLengthPower) - iLowerBrickX + 1;
+	const int32 iBricksHigh = (URegionHelper::GetUpperY(Region) >> uBrickSideLengthPower) - iLowerBrickY + 1;
+	const int32 iBricksDeep = (URegionHelper::GetUpperZ(Region) >> uBrickSideLengthPower) - iLowerBrickZ + 1;
+	Scratch.Reset(uRegionWidthInVoxels, uRegionHeightInVoxels, iBricksWide, iBricksWide * iBricksHigh * iBricksDeep);
+	EBrickOccupancy* brickOccupancy = Scratch.BrickOccupancy.GetData();
+	uint8* rowBrickStates = Scratch.RowBrickStates.GetData();
+	pPreviousRowCellIndices = Scratch.PreviousRowCellIndices.GetData();
+	pPreviousSliceCellIndices = Scratch.PreviousSliceCellIndices.GetData();
+	pIndices = Scratch.IndexSlabs[0].GetData();
+	pPreviousIndices = Scratch.IndexSlabs[1].GetData();
+	for (int32 iBrickZ = 0; iBrickZ < iBricksDeep; iBrickZ++)
+	{
+		for (int32 iBrickY = 0; iBrickY < iBricksHigh; iBrickY++)
+		{
+			for (int32 iBrickX = 0; iBrickX < iBricksWide; iBrickX++)
+			{
+				brickOccupancy[iBrickX + iBrickY * iBricksWide + iBrickZ * iBricksWide * iBricksHigh] = Volume->GetBrickOccupancy(iLowerBrickX + iBrickX, iLowerBrickY + iBrickY, iLowerBrickZ + iBrickZ, bPageIn);
+			}
+		}
+	}
+
+	// Densities the controller gives to fully solid and fully empty voxels
+	FVoxel solidVoxel;
+	solidVoxel.bIsSolid = true;
+	FVoxel emptyVoxel;
+	emptyVoxel.bIsSolid = false;
+	const bool bSolidIsBelowThreshold = controller->ConvertToDensity(solidVoxel) < Threshold;
+	const bool bEmptyIsBelowThreshold = controller->ConvertToDensity(emptyVoxel) < Threshold;
+	const uint8 uSolidSpanState = bSolidIsBelowThreshold ? SPAN_BELOW_THRESHOLD : SPAN_ABOVE_THRESHOLD;
+	const uint8 uEmptySpanState = bEmptyIsBelowThreshold ? SPAN_BELOW_THRESHOLD : SPAN_ABOVE_THRESHOLD;
+	const int32 iBrickMask = (1 << uBrickSideLengthPower) - 1;
 
 	// A sampler pointing at the beginning of the region, which gets incremented to always point at the beginning of a slice.
 
-	UVolumeSampler startOfSlice((UPagedVolumeComponent*)Volume);
-	startOfSlice.SetPosition(URegionHelper::GetLowerX(Region), URegionHelper::GetLowerY(Region), URegionHelper::GetLowerZ(Region));
+	UVolumeSampler startOfSlice((UPagedVolumeComponent*)Volume, BorderPolicy);
+	startOfSlice.SetPosition(iRegionLowerX, iRegionLowerY, iRegionLowerZ);
 
 	for (uint32 uZRegSpace = 0; uZRegSpace < uRegionDepthInVoxels; uZRegSpace++)
 	{
 		// A sampler pointing at the beginning of the slice, which gets incremented to always point at the beginning of a row.
 		UVolumeSampler startOfRow(startOfSlice);
+		const int32 iBrickSliceOffset = (((iRegionLowerZ + (int32)uZRegSpace) >> uBrickSideLengthPower) - iLowerBrickZ) * iBricksWide * iBricksHigh;
+		// The cells in this slice also have corners in the slice below, unless it's the first one. Corners outside
+		// the region only feed cells which never produce anything, so they don't count.
+		const int32 iCornerLowerBrickZ = ((iRegionLowerZ + (int32)uZRegSpace - (uZRegSpace > 0 ? 1 : 0)) >> uBrickSideLengthPower) - iLowerBrickZ;
+		const int32 iCornerUpperBrickZ = ((iRegionLowerZ + (int32)uZRegSpace) >> uBrickSideLengthPower) - iLowerBrickZ;
 
 		for (uint32 uYRegSpace = 0; uYRegSpace < uRegionHeightInVoxels; uYRegSpace++)
 		{
+			const int32 iBrickRowOffset = iBrickSliceOffset + (((iRegionLowerY + (int32)uYRegSpace) >> uBrickSideLengthPower) - iLowerBrickY) * iBricksWide;
+
+			// Work out which bricks along this row hold nothing but cells entirely above or below the threshold,
+			// taking in the bricks of the previous row and slice which those cells have corners in as well
+			const int32 iCornerLowerBrickY = ((iRegionLowerY + (int32)uYRegSpace - (uYRegSpace > 0 ? 1 : 0)) >> uBrickSideLengthPower) - iLowerBrickY;
+			const int32 iCornerUpperBrickY = ((iRegionLowerY + (int32)uYRegSpace) >> uBrickSideLengthPower) - iLowerBrickY;
+			for (int32 iBrickX = 0; iBrickX < iBricksWide; iBrickX++)
+			{
+				uint8 uState = SPAN_MIXED;
+				for (int32 iBrickZ = iCornerLowerBrickZ; iBrickZ <= iCornerUpperBrickZ; iBrickZ++)
+				{
+					for (int32 iBrickY = iCornerLowerBrickY; iBrickY <= iCornerUpperBrickY; iBrickY++)
+					{
+						const EBrickOccupancy occupancy = brickOccupancy[iBrickX + iBrickY * iBricksWide + iBrickZ * iBricksWide * iBricksHigh];
+						const uint8 uBrickState = occupancy == EBrickOccupancy::AllSolid ? uSolidSpanState : (occupancy == EBrickOccupancy::AllAir ? uEmptySpanState : SPAN_MIXED);
+						const bool bFirstBrick = iBrickZ == iCornerLowerBrickZ && iBrickY == iCornerLowerBrickY;
+						uState = bFirstBrick || uState == uBrickState ? uBrickState : SPAN_MIXED;
+					}
+				}
+				rowBrickStates[iBrickX] = uState;
+			}
+			uint32 uNextSpanStart = 0;
+
 			// Copying a sampler which is already pointing at the correct location seems (slightly) faster than
 			// calling setPosition(). Therefore we make use of 'startOfRow' and 'startOfSlice' to reset the sampler.
 			UVolumeSampler sampler(startOfRow);
 
 			for (uint32 uXRegSpace = 0; uXRegSpace < uRegionWidthInVoxels; uXRegSpace++)
 			{
+				if (uXRegSpace == uNextSpanStart)
+				{
+					// Each time the row enters a new brick, see whether every cell up to the end of that brick has all
+					// eight corners on the same side of the threshold. If so there is no surface anywhere in the run, so
+					// its cell indices are filled in directly and the cells are skipped.
+					const int32 iBrickX = ((iRegionLowerX + (int32)uXRegSpace) >> uBrickSideLengthPower) - iLowerBrickX;
+					uNextSpanStart = FMath::Min((uint32)(((iLowerBrickX + iBrickX + 1) << uBrickSideLengthPower) - iRegionLowerX), uRegionWidthInVoxels);
+					uint8 uSpanState = rowBrickStates[iBrickX];
+					if (uXRegSpace > 0 && ((iRegionLowerX + (int32)uXRegSpace) & iBrickMask) == 0 && rowBrickStates[iBrickX - 1] != uSpanState)
+					{
+						// The first cell's other corners are in the previous brick
+						uSpanState = SPAN_MIXED;
+					}
+					if (uSpanState != SPAN_MIXED)
+					{
+						const uint8 uSpanCellIndex = uSpanState == SPAN_BELOW_THRESHOLD ? 255 : 0;
+						const uint32 uSpanLength = uNextSpanStart - uXRegSpace;
+						FMemory::Memset(pPreviousRowCellIndices + uXRegSpace, uSpanCellIndex, uSpanLength);
+						FMemory::Memset(pPreviousSliceCellIndices + uXRegSpace + uYRegSpace * uRegionWidthInVoxels, uSpanCellIndex, uSpanLength);
+						uPreviousCellIndex = uSpanCellIndex;
+						if (uNextSpanStart < uRegionWidthInVoxels)
+						{
+							sampler.SetPosition(iRegionLowerX + (int32)uNextSpanStart, iRegionLowerY + (int32)uYRegSpace, iRegionLowerZ + (int32)uZRegSpace);
+						}
+						uXRegSpace = uNextSpanStart - 1;
+						continue;
+					}
+				}
+
 				// Note: In many cases the provided region will be (mostly) empty which means mesh vertices/indices 
 				// are not generated and the only thing that is done for each cell is the computation of uCellIndex.
 				// It appears that retrieving the voxel value is not so expensive and that it is the bitwise combining
@@ -201,10 +643,12 @@ FVoxelMesh UVoxelProceduralMeshComponent::GetEncodedMesh(UPagedVolumeComponent*
 
 				// Each bit of the cell index specifies whether a given corner of the cell is above or below the threshold.
 				uint8 uCellIndex = 0;
+				const uint32 uSliceIndex = uXRegSpace + uYRegSpace * uRegionWidthInVoxels;
+				const uint32 uEdgeIndex = uSliceIndex * 3;
 
 				// Four bits of our cube index are obtained by looking at the cube index for
 				// the previous slice and copying four of those bits into their new positions.
-				uint8 uPreviousCellIndexZ = UArrayHelper::Get2DUint8(pPreviousSliceCellIndices, uXRegSpace, uYRegSpace, uRegionWidthInVoxels);
+				uint8 uPreviousCellIndexZ = pPreviousSliceCellIndices[uSliceIndex];
 				uPreviousCellIndexZ >>= 4;
 				uCellIndex |= uPreviousCellIndexZ;
 
@@ -224,13 +668,26 @@ FVoxelMesh UVoxelProceduralMeshComponent::GetEncodedMesh(UPagedVolumeComponent*
 
 				// The last bit of our cube index is obtained by looking
 				// at the relevant voxel and comparing it to the threshold
-				FVoxel v111 = sampler.GetVoxel();
-				if (controller->ConvertToDensity(v111) < Threshold) uCellIndex |= 128;
+				const EBrickOccupancy brick = brickOccupancy[iBrickRowOffset + ((iRegionLowerX + (int32)uXRegSpace) >> uBrickSideLengthPower) - iLowerBrickX];
+				FVoxel v111;
+				if (brick == EBrickOccupancy::AllSolid)
+				{
+					if (bSolidIsBelowThreshold) uCellIndex |= 128;
+				}
+				else if (brick == EBrickOccupancy::AllAir)
+				{
+					if (bEmptyIsBelowThreshold) uCellIndex |= 128;
+				}
+				else
+				{
+					v111 = sampler.GetVoxel();
+					if (controller->ConvertToDensity(v111) < Threshold) uCellIndex |= 128;
+				}
 
 				// The current value becomes the previous value, ready for the next iteration.
 				uPreviousCellIndex = uCellIndex;
 				pPreviousRowCellIndices[uXRegSpace] = uCellIndex;
-				pPreviousSliceCellIndices = UArrayHelper::Set2DUint8(pPreviousSliceCellIndices, uCellIndex, uXRegSpace, uYRegSpace, uRegionWidthInVoxels);
+				pPreviousSliceCellIndices[uSliceIndex] = uCellIndex;
 
 				// 12 bits of uEdge determine whether a vertex is placed on each of the 12 edges of the cell.
 				uint16 uEdge = EdgeTable[uCellIndex];
@@ -252,6 +709,11 @@ FVoxelMesh UVoxelProceduralMeshComponent::GetEncodedMesh(UPagedVolumeComponent*
 				// calls). For now we will leave it as-is, until we have more information from real-world profiling.
 				if (uEdge != 0)
 				{
+					if (brick != EBrickOccupancy::Mixed)
+					{
+						// We skipped the lookup above, but the material is needed for blending
+						v111 = sampler.GetVoxel();
+					}
 					auto v111Density = controller->ConvertToDensity(v111);
 
 					// Performance note: Computing normals is one of the bottlencks in the mesh generation process. The
@@ -264,8 +726,7 @@ FVoxelMesh UVoxelProceduralMeshComponent::GetEncodedMesh(UPagedVolumeComponent*
 					/* Find the vertices where the surface intersects the cube */
 					if ((uEdge & 64) && (uXRegSpace > 0))
 					{
-						sampler.MoveNegativeX();
-						FVoxel v011 = sampler.GetVoxel();
+						FVoxel v011 = sampler.PeekVoxel1nx0py0pz();
 						auto v011Density = controller->ConvertToDensity(v011);
 						const float fInterp = static_cast<float>(Threshold - v011Density) / static_cast<float>(v111Density - v011Density);
 
@@ -292,18 +753,11 @@ FVoxelMesh UVoxelProceduralMeshComponent::GetEncodedMesh(UPagedVolumeComponent*
 						//surfaceVertex.encodedNormal = encodeNormal(v3dNormal);
 						surfaceVertex.Data = uMaterial;
 
-						result = AddVertex(result, surfaceVertex);
-						const uint32 uLastVertexIndex = result.Vertices.Num() - 1;
-						FVector pIndex = UArrayHelper::Get2DFVector(pIndices, uXRegSpace, uYRegSpace, uRegionWidthInVoxels);
-						pIndex.X = uLastVertexIndex;
-						pIndices = UArrayHelper::Set2DFVector(pIndices, pIndex, uXRegSpace, uYRegSpace, uRegionWidthInVoxels);
-
-						sampler.MovePositiveX();
+						pIndices[uEdgeIndex + 0] = AddVertex(result, surfaceVertex);
 					}
 					if ((uEdge & 32) && (uYRegSpace > 0))
 					{
-						sampler.MoveNegativeY();
-						FVoxel v101 = sampler.GetVoxel();
+						FVoxel v101 = sampler.PeekVoxel0px1ny0pz();
 						auto v101Density = controller->ConvertToDensity(v101);
 						const float fInterp = static_cast<float>(Threshold - v101Density) / static_cast<float>(v111Density - v101Density);
 
@@ -330,18 +784,11 @@ FVoxelMesh UVoxelProceduralMeshComponent::GetEncodedMesh(UPagedVolumeComponent*
 						//surfaceVertex.encodedNormal = encodeNormal(v3dNormal);
 						surfaceVertex.Data = uMaterial;
 
-						result = AddVertex(result, surfaceVertex);
-						const uint32 uLastVertexIndex = result.Vertices.Num() - 1;
-						FVector pIndex = UArrayHelper::Get2DFVector(pIndices, uXRegSpace, uYRegSpace, uRegionWidthInVoxels);
-						pIndex.Y = uLastVertexIndex;
-						pIndices = UArrayHelper::Set2DFVector(pIndices, pIndex, uXRegSpace, uYRegSpace, uRegionWidthInVoxels);
-
-						sampler.MovePositiveY();
+						pIndices[uEdgeIndex + 1] = AddVertex(result, surfaceVertex);
 					}
 					if ((uEdge & 1024) && (uZRegSpace > 0))
 					{
-						sampler.MoveNegativeZ();
-						FVoxel v110 = sampler.GetVoxel();
+						FVoxel v110 = sampler.PeekVoxel0px0py1nz();
 						auto v110Density = controller->ConvertToDensity(v110);
 						const float fInterp = static_cast<float>(Threshold - v110Density) / static_cast<float>(v111Density - v110Density);
 
@@ -368,13 +815,7 @@ FVoxelMesh UVoxelProceduralMeshComponent::GetEncodedMesh(UPagedVolumeComponent*
 						//surfaceVertex.encodedNormal = encodeNormal(v3dNormal);
 						surfaceVertex.Data = uMaterial;
 
-						result = AddVertex(result, surfaceVertex);
-						const uint32 uLastVertexIndex = result.Vertices.Num() - 1;
-						FVector pIndex = UArrayHelper::Get2DFVector(pIndices, uXRegSpace, uYRegSpace, uRegionWidthInVoxels);
-						pIndex.Z = uLastVertexIndex;
-						pIndices = UArrayHelper::Set2DFVector(pIndices, pIndex, uXRegSpace, uYRegSpace, uRegionWidthInVoxels);
-
-						sampler.MovePositiveZ();
+						pIndices[uEdgeIndex + 2] = AddVertex(result, surfaceVertex);
 					}
 
 					// Now output the indices. For the first row, column or slice there aren't
@@ -387,51 +828,51 @@ FVoxelMesh UVoxelProceduralMeshComponent::GetEncodedMesh(UPagedVolumeComponent*
 						/* Find the vertices where the surface intersects the cube */
 						if (uEdge & 1)
 						{
-							indlist[0] = UArrayHelper::Get2DFVector(pPreviousIndices, uXRegSpace, uYRegSpace - 1, uRegionWidthInVoxels).X;
+							indlist[0] = pPreviousIndices[uEdgeIndex - uIndexRowStride + 0];
 						}
 						if (uEdge & 2)
 						{
-							indlist[1] = UArrayHelper::Get2DFVector(pPreviousIndices, uXRegSpace, uYRegSpace, uRegionWidthInVoxels).Y;
+							indlist[1] = pPreviousIndices[uEdgeIndex + 1];
 						}
 						if (uEdge & 4)
 						{
-							indlist[2] = UArrayHelper::Get2DFVector(pPreviousIndices, uXRegSpace, uYRegSpace, uRegionWidthInVoxels).X;
+							indlist[2] = pPreviousIndices[uEdgeIndex + 0];
 						}
 						if (uEdge & 8)
 						{
-							indlist[3] = UArrayHelper::Get2DFVector(pPreviousIndices, uXRegSpace - 1, uYRegSpace, uRegionWidthInVoxels).Y;
+							indlist[3] = pPreviousIndices[uEdgeIndex - 3 + 1];
 						}
 						if (uEdge & 16)
 						{
-							indlist[4] = UArrayHelper::Get2DFVector(pIndices, uXRegSpace, uYRegSpace - 1, uRegionWidthInVoxels).X;
+							indlist[4] = pIndices[uEdgeIndex - uIndexRowStride + 0];
 						}
 						if (uEdge & 32)
 						{
-							indlist[5] = UArrayHelper::Get2DFVector(pIndices, uXRegSpace, uYRegSpace, uRegionWidthInVoxels).Y;
+							indlist[5] = pIndices[uEdgeIndex + 1];
 						}
 						if (uEdge & 64)
 						{
-							indlist[6] = UArrayHelper::Get2DFVector(pIndices, uXRegSpace, uYRegSpace, uRegionWidthInVoxels).X;
+							indlist[6] = pIndices[uEdgeIndex + 0];
 						}
 						if (uEdge & 128)
 						{
-							indlist[7] = UArrayHelper::Get2DFVector(pIndices, uXRegSpace - 1, uYRegSpace, uRegionWidthInVoxels).Y;
+							indlist[7] = pIndices[uEdgeIndex - 3 + 1];
 						}
 						if (uEdge & 256)
 						{
-							indlist[8] = UArrayHelper::Get2DFVector(pIndices, uXRegSpace - 1, uYRegSpace - 1, uRegionWidthInVoxels).Z;
+							indlist[8] = pIndices[uEdgeIndex - 3 - uIndexRowStride + 2];
 						}
 						if (uEdge & 512)
 						{
-							indlist[9] = UArrayHelper::Get2DFVector(pIndices, uXRegSpace, uYRegSpace - 1, uRegionWidthInVoxels).Z;
+							indlist[9] = pIndices[uEdgeIndex - uIndexRowStride + 2];
 						}
 						if (uEdge & 1024)
 						{
-							indlist[10] = UArrayHelper::Get2DFVector(pIndices, uXRegSpace, uYRegSpace, uRegionWidthInVoxels).Z;
+							indlist[10] = pIndices[uEdgeIndex + 2];
 						}
 						if (uEdge & 2048)
 						{
-							indlist[11] = UArrayHelper::Get2DFVector(pIndices, uXRegSpace - 1, uYRegSpace, uRegionWidthInVoxels).Z;
+							indlist[11] = pIndices[uEdgeIndex - 3 + 2];
 						}
 
 						for (int i = 0; TriTable[uCellIndex][i] != -1; i += 3)
@@ -442,7 +883,7 @@ FVoxelMesh UVoxelProceduralMeshComponent::GetEncodedMesh(UPagedVolumeComponent*
 
 							if ((ind0 != -1) && (ind1 != -1) && (ind2 != -1))
 							{
-								result = AddTriangle(result, ind0, ind1, ind2);
+								AddTriangle(result, ind0, ind1, ind2);
 							}
 						} // For each triangle
 					}
@@ -453,18 +894,18 @@ FVoxelMesh UVoxelProceduralMeshComponent::GetEncodedMesh(UPagedVolumeComponent*
 		} // For Y
 		startOfSlice.MovePositiveZ();
 
-		TArray<FVector> tem = pIndices;
-		pIndices = pPreviousIndices;
-		pPreviousIndices = tem;
+		Swap(pIndices, pPreviousIndices);
 	} // For Z
 
 	result.Offset = URegionHelper::GetLowerCorner(Region);
 	return result;
 }
 
-FVoxelMesh UVoxelProceduralMeshComponent::GetDecodedMesh(FVoxelMesh EncodedMesh)
+FVoxelMesh UVoxelProceduralMeshComponent::GetDecodedMesh(const FVoxelMesh& EncodedMesh)
 {
 	FVoxelMesh decodedMesh;
+	decodedMesh.Vertices.Reserve(EncodedMesh.Vertices.Num());
+	decodedMesh.Indices.Reserve(EncodedMesh.Indices.Num());
 
 	for (int32 ct = 0; ct < EncodedMesh.Vertices.Num(); ct++)
 	{
@@ -476,13 +917,13 @@ FVoxelMesh UVoxelProceduralMeshComponent::GetDecodedMesh(FVoxelMesh EncodedMesh)
 		decodedVertex.Position = result;
 		decodedVertex.Data = EncodedMesh.Vertices[ct].Data;
 		
-		decodedMesh = AddVertex(decodedMesh, decodedVertex);
+		AddVertex(decodedMesh, decodedVertex);
 	}
 
 	checkf(EncodedMesh.Indices.Num() % 3 == 0, TEXT("The number of indices must always be a multiple of three."));
 	for (int32 ct = 0; ct < EncodedMesh.Indices.Num(); ct += 3)
 	{
-		decodedMesh = AddTriangle(decodedMesh, EncodedMesh.Indices[ct], EncodedMesh.Indices[ct + 1], EncodedMesh.Indices[ct + 2]);
+		AddTriangle(decodedMesh, EncodedMesh.Indices[ct], EncodedMesh.Indices[ct + 1], EncodedMesh.Indices[ct + 2]);
 	}
 
 	decodedMesh.Offset = EncodedMesh.Offset;
@@ -0,0 +1,129 @@
+/*******************************************************************************
+The MIT License (MIT)
+
+Copyright (c) 2017 Jay Stevens
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*******************************************************************************/
+
+#include "PolyVoxPrivatePCH.h"
+#include "ChunkBufferPool.h"
+
+FChunkBufferPool::FChunkBufferPool(int32 MaxFreeBuffersPerSize /*= 64*/)
+{
+	this->MaxFreeBuffersPerSize = MaxFreeBuffersPerSize;
+	Hits = 0;
+	Misses = 0;
+	OutstandingBytes = 0;
+	HighWaterBytes = 0;
+	PooledBytes = 0;
+}
+
+FChunkBufferPool::~FChunkBufferPool()
+{
+	Empty();
+}
+
+void FChunkBufferPool::Acquire(int32 NumWords, TArray<uint64>& OutBuffer)
+{
+	Release(OutBuffer);
+	if (NumWords <= 0)
+	{
+		return;
+	}
+
+	{
+		FScopeLock lock(&PoolLock);
+		TArray<TArray<uint64>>* freeList = FreeBuffers.Find(NumWords);
+		if (freeList != nullptr && freeList->Num() > 0)
+		{
+			OutBuffer = freeList->Pop(false);
+			PooledBytes -= NumWords * sizeof(uint64);
+			Hits++;
+		}
+		else
+		{
+			Misses++;
+		}
+		OutstandingBytes += NumWords * sizeof(uint64);
+		HighWaterBytes = FMath::Max(HighWaterBytes, OutstandingBytes);
+	}
+
+	// Clearing is done outside of the lock, since it's the expensive part
+	if (OutBuffer.Num() == NumWords)
+	{
+		FMemory::Memzero(OutBuffer.GetData(), NumWords * sizeof(uint64));
+	}
+	else
+	{
+		OutBuffer.SetNumZeroed(NumWords);
+	}
+}
+
+void FChunkBufferPool::Release(TArray<uint64>& Buffer)
+{
+	const int32 numWords = Buffer.Num();
+	if (numWords == 0)
+	{
+		Buffer.Empty();
+		return;
+	}
+
+	FScopeLock lock(&PoolLock);
+	OutstandingBytes -= numWords * sizeof(uint64);
+
+	TArray<TArray<uint64>>& freeList = FreeBuffers.FindOrAdd(numWords);
+	if (freeList.Num() < MaxFreeBuffersPerSize)
+	{
+		freeList.Add(MoveTemp(Buffer));
+		PooledBytes += numWords * sizeof(uint64);
+	}
+	Buffer.Empty();
+}
+
+void FChunkBufferPool::Empty()
+{
+	FScopeLock lock(&PoolLock);
+	FreeBuffers.Empty();
+	PooledBytes = 0;
+}
+
+int32 FChunkBufferPool::GetHits() const
+{
+	FScopeLock lock(&PoolLock);
+	return Hits;
+}
+
+int32 FChunkBufferPool::GetMisses() const
+{
+	FScopeLock lock(&PoolLock);
+	return Misses;
+}
+
+int64 FChunkBufferPool::GetHighWaterBytes() const
+{
+	FScopeLock lock(&PoolLock);
+	return HighWaterBytes;
+}
+
+int64 FChunkBufferPool::GetPooledBytes() const
+{
+	FScopeLock lock(&PoolLock);
+	return PooledBytes;
+}
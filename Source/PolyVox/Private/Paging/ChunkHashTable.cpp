@@ -0,0 +1,172 @@
+/*******************************************************************************
+The MIT License (MIT)
+
+Copyright (c) 2017 Jay Stevens
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*******************************************************************************/
+
+#include "PolyVoxPrivatePCH.h"
+#include "ChunkHashTable.h"
+#include "PagedChunkData.h"
+
+FChunkHashTable::FChunkHashTable(int32 InitialCapacity /*= 1024*/)
+{
+	Empty(InitialCapacity);
+}
+
+void FChunkHashTable::Empty(int32 InitialCapacity /*= 1024*/)
+{
+	const int32 capacity = FMath::RoundUpToPowerOfTwo(FMath::Max(InitialCapacity, 16));
+	Keys.Empty(capacity);
+	Keys.SetNumZeroed(capacity);
+	Chunks.Empty(capacity);
+	Chunks.SetNumZeroed(capacity);
+	Count = 0;
+	SlotMask = capacity - 1;
+}
+
+FPagedChunkData* FChunkHashTable::Find(int32 ChunkX, int32 ChunkY, int32 ChunkZ) const
+{
+	const int32 slot = FindSlot(PackKey(ChunkX, ChunkY, ChunkZ));
+	return slot == INDEX_NONE ? NULL : Chunks[slot];
+}
+
+void FChunkHashTable::Add(FPagedChunkData* Chunk)
+{
+	checkf(Chunk != NULL, TEXT("Can't add a null chunk to the chunk table."));
+	const FIntVector& position = Chunk->GetChunkSpacePosition();
+	const uint64 key = PackKey(position.X, position.Y, position.Z);
+	checkf(FindSlot(key) == INDEX_NONE, TEXT("Chunk (%d, %d, %d) is already in the chunk table."), position.X, position.Y, position.Z);
+
+	if ((Count + 1) * 2 > Chunks.Num())
+	{
+		Grow();
+	}
+	Insert(key, Chunk);
+	Count++;
+}
+
+FPagedChunkData* FChunkHashTable::Remove(int32 ChunkX, int32 ChunkY, int32 ChunkZ)
+{
+	int32 slot = FindSlot(PackKey(ChunkX, ChunkY, ChunkZ));
+	if (slot == INDEX_NONE)
+	{
+		return NULL;
+	}
+	FPagedChunkData* removed = Chunks[slot];
+	Chunks[slot] = NULL;
+	Count--;
+
+	// Close the gap: any entry further along the probe sequence which would have liked to be at or before the
+	// hole gets moved back into it, which opens a new hole further along.
+	uint32 hole = (uint32)slot;
+	uint32 next = (hole + 1) & SlotMask;
+	while (Chunks[next] != NULL)
+	{
+		const uint32 ideal = (uint32)HashKey(Keys[next]) & SlotMask;
+		if (((next - ideal) & SlotMask) >= ((next - hole) & SlotMask))
+		{
+			Keys[hole] = Keys[next];
+			Chunks[hole] = Chunks[next];
+			Chunks[next] = NULL;
+			hole = next;
+		}
+		next = (next + 1) & SlotMask;
+	}
+	return removed;
+}
+
+int32 FChunkHashTable::Num() const
+{
+	return Count;
+}
+
+int32 FChunkHashTable::GetCapacity() const
+{
+	return Chunks.Num();
+}
+
+FPagedChunkData* FChunkHashTable::GetAtSlot(int32 Slot) const
+{
+	return Chunks[Slot];
+}
+
+uint64 FChunkHashTable::PackKey(int32 ChunkX, int32 ChunkY, int32 ChunkZ)
+{
+	checkSlow(ChunkX >= -(1 << 20) && ChunkX < (1 << 20));
+	checkSlow(ChunkY >= -(1 << 20) && ChunkY < (1 << 20));
+	checkSlow(ChunkZ >= -(1 << 20) && ChunkZ < (1 << 20));
+	const uint64 axisMask = (1ull << 21) - 1;
+	return ((uint64)ChunkX & axisMask) | (((uint64)ChunkY & axisMask) << 21) | (((uint64)ChunkZ & axisMask) << 42);
+}
+
+uint64 FChunkHashTable::HashKey(uint64 Key)
+{
+	// SplitMix64 finalizer; every bit of the key affects every bit of the hash.
+	Key ^= Key >> 30;
+	Key *= 0xbf58476d1ce4e5b9ull;
+	Key ^= Key >> 27;
+	Key *= 0x94d049bb133111ebull;
+	Key ^= Key >> 31;
+	return Key;
+}
+
+int32 FChunkHashTable::FindSlot(uint64 Key) const
+{
+	uint32 slot = (uint32)HashKey(Key) & SlotMask;
+	while (Chunks[slot] != NULL)
+	{
+		if (Keys[slot] == Key)
+		{
+			return (int32)slot;
+		}
+		slot = (slot + 1) & SlotMask;
+	}
+	return INDEX_NONE;
+}
+
+void FChunkHashTable::Insert(uint64 Key, FPagedChunkData* Chunk)
+{
+	uint32 slot = (uint32)HashKey(Key) & SlotMask;
+	while (Chunks[slot] != NULL)
+	{
+		slot = (slot + 1) & SlotMask;
+	}
+	Keys[slot] = Key;
+	Chunks[slot] = Chunk;
+}
+
+void FChunkHashTable::Grow()
+{
+	TArray<uint64> oldKeys = MoveTemp(Keys);
+	TArray<FPagedChunkData*> oldChunks = MoveTemp(Chunks);
+
+	const int32 capacity = oldChunks.Num() * 2;
+	Keys.SetNumZeroed(capacity);
+	Chunks.SetNumZeroed(capacity);
+	SlotMask = capacity - 1;
+	for (int32 i = 0; i < oldChunks.Num(); i++)
+	{
+		if (oldChunks[i] != NULL)
+		{
+			Insert(oldKeys[i], oldChunks[i]);
+		}
+	}
+}
@@ -0,0 +1,151 @@
+/*******************************************************************************
+The MIT License (MIT)
+
+Copyright (c) 2017 Jay Stevens
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*******************************************************************************/
+
+#include "PolyVoxPrivatePCH.h"
+#include "Utils/Morton.h"
+#include "PagedChunkData.h"
+#include "ChunkRegionView.h"
+
+FChunkRegionView::FChunkRegionView(FPagedChunkData* ViewedChunk, const FIntVector& ChunkOrigin, const FIntVector& LowerBound, const FIntVector& UpperBound)
+{
+	checkf(ViewedChunk != NULL, TEXT("Provided chunk cannot be null"));
+	Chunk = ViewedChunk;
+	Origin = ChunkOrigin;
+	Lower = LowerBound;
+	Upper = UpperBound;
+	bModified = false;
+	ModifiedLower = FIntVector::ZeroValue;
+	ModifiedUpper = FIntVector::ZeroValue;
+}
+
+const FIntVector& FChunkRegionView::GetChunkOrigin() const
+{
+	return Origin;
+}
+
+const FIntVector& FChunkRegionView::GetLower() const
+{
+	return Lower;
+}
+
+const FIntVector& FChunkRegionView::GetUpper() const
+{
+	return Upper;
+}
+
+bool FChunkRegionView::CoversWholeChunk() const
+{
+	const int32 last = Chunk->SideLength - 1;
+	return Lower == FIntVector::ZeroValue && Upper.X == last && Upper.Y == last && Upper.Z == last;
+}
+
+bool FChunkRegionView::IsUniform() const
+{
+	return Chunk->IsUniform();
+}
+
+FVoxel FChunkRegionView::GetUniformVoxel() const
+{
+	return Chunk->GetUniformVoxel();
+}
+
+FVoxel FChunkRegionView::GetVoxel(int32 XPos, int32 YPos, int32 ZPos) const
+{
+	return Chunk->GetVoxelByCoordinatesChunkSpace(XPos, YPos, ZPos);
+}
+
+void FChunkRegionView::SetVoxel(int32 XPos, int32 YPos, int32 ZPos, FVoxel Voxel)
+{
+	checkf(XPos >= Lower.X && XPos <= Upper.X && YPos >= Lower.Y && YPos <= Upper.Y && ZPos >= Lower.Z && ZPos <= Upper.Z, TEXT("Supplied position (%d, %d, %d) is outside of the view"), XPos, YPos, ZPos);
+
+	// Only the voxel data is written here. The solidity plane is rebuilt once the visitor is done with the chunk,
+	// which is far cheaper than keeping it up to date one voxel at a time.
+	const uint32 index = morton256_x[XPos] | morton256_y[YPos] | morton256_z[ZPos];
+	if (Chunk->VoxelData.Get(index) == Voxel)
+	{
+		return;
+	}
+	Chunk->VoxelData.Set(index, Voxel);
+
+	const FIntVector position(XPos, YPos, ZPos);
+	GrowModifiedRegion(position, position);
+}
+
+void FChunkRegionView::Fill(FVoxel Voxel)
+{
+	if (Chunk->IsUniform() && Chunk->GetUniformVoxel() == Voxel)
+	{
+		// Already there
+		return;
+	}
+	if (CoversWholeChunk())
+	{
+		Chunk->WriteUniform(Voxel);
+		GrowModifiedRegion(Lower, Upper);
+		return;
+	}
+
+	for (int32 z = Lower.Z; z <= Upper.Z; z++)
+	{
+		for (int32 y = Lower.Y; y <= Upper.Y; y++)
+		{
+			for (int32 x = Lower.X; x <= Upper.X; x++)
+			{
+				SetVoxel(x, y, z, Voxel);
+			}
+		}
+	}
+}
+
+bool FChunkRegionView::WasModified() const
+{
+	return bModified;
+}
+
+const FIntVector& FChunkRegionView::GetModifiedLower() const
+{
+	return ModifiedLower;
+}
+
+const FIntVector& FChunkRegionView::GetModifiedUpper() const
+{
+	return ModifiedUpper;
+}
+
+void FChunkRegionView::GrowModifiedRegion(const FIntVector& NewLower, const FIntVector& NewUpper)
+{
+	if (!bModified)
+	{
+		ModifiedLower = NewLower;
+		ModifiedUpper = NewUpper;
+		bModified = true;
+		return;
+	}
+	ModifiedLower.X = FMath::Min(ModifiedLower.X, NewLower.X);
+	ModifiedLower.Y = FMath::Min(ModifiedLower.Y, NewLower.Y);
+	ModifiedLower.Z = FMath::Min(ModifiedLower.Z, NewLower.Z);
+	ModifiedUpper.X = FMath::Max(ModifiedUpper.X, NewUpper.X);
+	ModifiedUpper.Y = FMath::Max(ModifiedUpper.Y, NewUpper.Y);
+	ModifiedUpper.Z = FMath::Max(ModifiedUpper.Z, NewUpper.Z);
+}
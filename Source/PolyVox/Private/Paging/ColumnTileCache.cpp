@@ -0,0 +1,185 @@
+/*******************************************************************************
+The MIT License (MIT)
+
+Copyright (c) 2017 Jay Stevens
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*******************************************************************************/
+
+#include "PolyVoxPrivatePCH.h"
+#include "ColumnTileCache.h"
+
+FColumnTileCache::FColumnTileCache(int32 MaxTiles /*= 1024*/)
+{
+	this->MaxTiles = FMath::Max(MaxTiles, 0);
+	MostRecentlyUsedSlot = INDEX_NONE;
+	LeastRecentlyUsedSlot = INDEX_NONE;
+	Hits = 0;
+	Misses = 0;
+}
+
+void FColumnTileCache::SetMaxTiles(int32 NewMaxTiles)
+{
+	FScopeLock lock(&CacheLock);
+	MaxTiles = FMath::Max(NewMaxTiles, 0);
+	while (SlotsByKey.Num() > MaxTiles)
+	{
+		DropLeastRecentlyUsed();
+	}
+}
+
+FColumnTilePtr FColumnTileCache::Find(int32 ChunkX, int32 ChunkY, int32 Seed)
+{
+	FScopeLock lock(&CacheLock);
+	const int32* slot = SlotsByKey.Find(FIntVector(ChunkX, ChunkY, Seed));
+	if (slot == NULL)
+	{
+		Misses++;
+		return FColumnTilePtr();
+	}
+	Hits++;
+	MarkUsed(*slot);
+	return Slots[*slot].Tile;
+}
+
+void FColumnTileCache::Add(int32 ChunkX, int32 ChunkY, int32 Seed, const FColumnTilePtr& Tile)
+{
+	FScopeLock lock(&CacheLock);
+	if (MaxTiles == 0)
+	{
+		return;
+	}
+
+	const FIntVector key(ChunkX, ChunkY, Seed);
+	const int32* existingSlot = SlotsByKey.Find(key);
+	if (existingSlot != NULL)
+	{
+		// Another thread made the same tile at the same time; either copy will do
+		Slots[*existingSlot].Tile = Tile;
+		MarkUsed(*existingSlot);
+		return;
+	}
+
+	if (SlotsByKey.Num() >= MaxTiles)
+	{
+		DropLeastRecentlyUsed();
+	}
+	int32 slot = INDEX_NONE;
+	if (FreeSlots.Num() > 0)
+	{
+		slot = FreeSlots.Pop(false);
+	}
+	else
+	{
+		slot = Slots.AddDefaulted();
+	}
+	Slots[slot].Key = key;
+	Slots[slot].Tile = Tile;
+	Slots[slot].MoreRecentlyUsed = INDEX_NONE;
+	Slots[slot].LessRecentlyUsed = INDEX_NONE;
+	SlotsByKey.Add(key, slot);
+	MarkUsed(slot);
+}
+
+void FColumnTileCache::Empty()
+{
+	FScopeLock lock(&CacheLock);
+	Slots.Empty();
+	FreeSlots.Empty();
+	SlotsByKey.Empty();
+	MostRecentlyUsedSlot = INDEX_NONE;
+	LeastRecentlyUsedSlot = INDEX_NONE;
+}
+
+int32 FColumnTileCache::GetHits() const
+{
+	FScopeLock lock(&CacheLock);
+	return Hits;
+}
+
+int32 FColumnTileCache::GetMisses() const
+{
+	FScopeLock lock(&CacheLock);
+	return Misses;
+}
+
+int32 FColumnTileCache::Num() const
+{
+	FScopeLock lock(&CacheLock);
+	return SlotsByKey.Num();
+}
+
+void FColumnTileCache::MarkUsed(int32 Slot)
+{
+	if (MostRecentlyUsedSlot == Slot)
+	{
+		return;
+	}
+	Unlink(Slot);
+
+	FTileSlot& tileSlot = Slots[Slot];
+	tileSlot.MoreRecentlyUsed = INDEX_NONE;
+	tileSlot.LessRecentlyUsed = MostRecentlyUsedSlot;
+	if (MostRecentlyUsedSlot != INDEX_NONE)
+	{
+		Slots[MostRecentlyUsedSlot].MoreRecentlyUsed = Slot;
+	}
+	MostRecentlyUsedSlot = Slot;
+	if (LeastRecentlyUsedSlot == INDEX_NONE)
+	{
+		LeastRecentlyUsedSlot = Slot;
+	}
+}
+
+void FColumnTileCache::Unlink(int32 Slot)
+{
+	FTileSlot& tileSlot = Slots[Slot];
+	if (tileSlot.MoreRecentlyUsed != INDEX_NONE)
+	{
+		Slots[tileSlot.MoreRecentlyUsed].LessRecentlyUsed = tileSlot.LessRecentlyUsed;
+	}
+	else if (MostRecentlyUsedSlot == Slot)
+	{
+		MostRecentlyUsedSlot = tileSlot.LessRecentlyUsed;
+	}
+	if (tileSlot.LessRecentlyUsed != INDEX_NONE)
+	{
+		Slots[tileSlot.LessRecentlyUsed].MoreRecentlyUsed = tileSlot.MoreRecentlyUsed;
+	}
+	else if (LeastRecentlyUsedSlot == Slot)
+	{
+		LeastRecentlyUsedSlot = tileSlot.MoreRecentlyUsed;
+	}
+	tileSlot.MoreRecentlyUsed = INDEX_NONE;
+	tileSlot.LessRecentlyUsed = INDEX_NONE;
+}
+
+void FColumnTileCache::DropLeastRecentlyUsed()
+{
+	const int32 slot = LeastRecentlyUsedSlot;
+	if (slot == INDEX_NONE)
+	{
+		return;
+	}
+	Unlink(slot);
+	SlotsByKey.Remove(Slots[slot].Key);
+	// Anyone still using the tile keeps it alive through their own pointer
+	Slots[slot].Tile.Reset();
+	FreeSlots.Add(slot);
+}
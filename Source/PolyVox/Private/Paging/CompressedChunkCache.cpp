@@ -0,0 +1,209 @@
+/*******************************************************************************
+The MIT License (MIT)
+
+Copyright (c) 2017 Jay Stevens
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*******************************************************************************/
+
+#include "PolyVoxPrivatePCH.h"
+#include "CompressedChunkCache.h"
+
+FCompressedChunkCache::FCompressedChunkCache(int64 BudgetInBytes /*= 0*/)
+{
+	this->BudgetInBytes = BudgetInBytes;
+	EvictionOrderHead = 0;
+	NextSerial = 0;
+	CachedBytes = 0;
+	Hits = 0;
+	Misses = 0;
+	Evictions = 0;
+}
+
+void FCompressedChunkCache::SetBudget(int64 NewBudgetInBytes)
+{
+	FScopeLock lock(&CacheLock);
+	BudgetInBytes = NewBudgetInBytes;
+	Trim();
+}
+
+void FCompressedChunkCache::Add(const FIntVector& Position, TArray<uint8>& Bytes)
+{
+	FScopeLock lock(&CacheLock);
+	FCachedChunk* existing = CachedChunks.Find(Position);
+	if (existing != NULL)
+	{
+		// Whatever was here is older than what we've been given
+		CachedBytes -= GetEntrySize(*existing);
+		CachedChunks.Remove(Position);
+	}
+
+	FCachedChunk entry;
+	entry.Bytes = MoveTemp(Bytes);
+	entry.Serial = NextSerial++;
+	Bytes.Empty();
+	if (GetEntrySize(entry) > BudgetInBytes)
+	{
+		// It would push everything else out and still not fit
+		Trim();
+		return;
+	}
+
+	FEvictionOrderEntry order;
+	order.Position = Position;
+	order.Serial = entry.Serial;
+	EvictionOrder.Add(order);
+	CachedBytes += GetEntrySize(entry);
+	CachedChunks.Add(Position, MoveTemp(entry));
+	Trim();
+}
+
+bool FCompressedChunkCache::Take(const FIntVector& Position, TArray<uint8>& OutBytes)
+{
+	FScopeLock lock(&CacheLock);
+	FCachedChunk* entry = CachedChunks.Find(Position);
+	if (entry == NULL)
+	{
+		Misses++;
+		return false;
+	}
+	CachedBytes -= GetEntrySize(*entry);
+	OutBytes = MoveTemp(entry->Bytes);
+	CachedChunks.Remove(Position);
+	Hits++;
+	SkipStaleEvictionOrderEntries();
+	return true;
+}
+
+void FCompressedChunkCache::Remove(const FIntVector& Position)
+{
+	FScopeLock lock(&CacheLock);
+	FCachedChunk* entry = CachedChunks.Find(Position);
+	if (entry != NULL)
+	{
+		CachedBytes -= GetEntrySize(*entry);
+		CachedChunks.Remove(Position);
+		SkipStaleEvictionOrderEntries();
+	}
+}
+
+void FCompressedChunkCache::Empty()
+{
+	FScopeLock lock(&CacheLock);
+	CachedChunks.Empty();
+	EvictionOrder.Empty();
+	EvictionOrderHead = 0;
+	CachedBytes = 0;
+}
+
+int32 FCompressedChunkCache::GetHits() const
+{
+	FScopeLock lock(&CacheLock);
+	return Hits;
+}
+
+int32 FCompressedChunkCache::GetMisses() const
+{
+	FScopeLock lock(&CacheLock);
+	return Misses;
+}
+
+int32 FCompressedChunkCache::GetEvictions() const
+{
+	FScopeLock lock(&CacheLock);
+	return Evictions;
+}
+
+int64 FCompressedChunkCache::GetBytes() const
+{
+	FScopeLock lock(&CacheLock);
+	return CachedBytes;
+}
+
+int32 FCompressedChunkCache::Num() const
+{
+	FScopeLock lock(&CacheLock);
+	return CachedChunks.Num();
+}
+
+int64 FCompressedChunkCache::GetEntrySize(const FCachedChunk& Entry)
+{
+	// Uniform chunks compress down to a handful of bytes, so the map and eviction order entries are worth counting too
+	return Entry.Bytes.Num() + sizeof(FIntVector) + sizeof(FCachedChunk) + sizeof(FEvictionOrderEntry);
+}
+
+void FCompressedChunkCache::Trim()
+{
+	while (CachedBytes > BudgetInBytes && EvictionOrderHead < EvictionOrder.Num())
+	{
+		const FEvictionOrderEntry& oldest = EvictionOrder[EvictionOrderHead++];
+		FCachedChunk* entry = CachedChunks.Find(oldest.Position);
+		if (entry != NULL && entry->Serial == oldest.Serial)
+		{
+			CachedBytes -= GetEntrySize(*entry);
+			CachedChunks.Remove(oldest.Position);
+			Evictions++;
+		}
+	}
+	SkipStaleEvictionOrderEntries();
+}
+
+void FCompressedChunkCache::SkipStaleEvictionOrderEntries()
+{
+	while (EvictionOrderHead < EvictionOrder.Num())
+	{
+		const FEvictionOrderEntry& oldest = EvictionOrder[EvictionOrderHead];
+		const FCachedChunk* entry = CachedChunks.Find(oldest.Position);
+		if (entry != NULL && entry->Serial == oldest.Serial)
+		{
+			break;
+		}
+		EvictionOrderHead++;
+	}
+
+	if (EvictionOrderHead == EvictionOrder.Num())
+	{
+		EvictionOrder.Reset();
+		EvictionOrderHead = 0;
+	}
+	else if (EvictionOrder.Num() - EvictionOrderHead > 2 * CachedChunks.Num() + 1024)
+	{
+		// Chunks taken out of the middle leave stale entries behind the head, which would pile up forever if the
+		// oldest chunk is never taken or dropped. Once they outnumber the live ones, copy the live ones out.
+		TArray<FEvictionOrderEntry> liveEntries;
+		liveEntries.Reserve(CachedChunks.Num());
+		for (int32 i = EvictionOrderHead; i < EvictionOrder.Num(); i++)
+		{
+			const FCachedChunk* entry = CachedChunks.Find(EvictionOrder[i].Position);
+			if (entry != NULL && entry->Serial == EvictionOrder[i].Serial)
+			{
+				liveEntries.Add(EvictionOrder[i]);
+			}
+		}
+		EvictionOrder = MoveTemp(liveEntries);
+		EvictionOrderHead = 0;
+	}
+	else if (EvictionOrderHead > EvictionOrder.Num() / 2)
+	{
+		// A cache which stays full never empties out, so the entries already consumed by the head have to be dropped
+		// as well, or the array would grow with every chunk added
+		EvictionOrder.RemoveAt(0, EvictionOrderHead, false);
+		EvictionOrderHead = 0;
+	}
+}
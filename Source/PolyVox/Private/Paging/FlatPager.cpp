@@ -1,23 +1,26 @@
 // Fill out your copyright notice in the Description page of Project Settings.
 
 #include "PolyVoxPrivatePCH.h"
+#include "PagedChunkData.h"
 #include "FlatPager.h"
 
-void UFlatPager::PageIn_Implementation(const FRegion& Region, APagedChunk* Chunk)
+void UFlatPager::PageIn(const FRegion& Region, FPagedChunkData* Chunk)
 {
-	for (int x = Region.LowerX; x < Region.UpperX; x++)
+	// Every chunk is either entirely above the ground, entirely below it, or has the surface running through it,
+	// so each one can be filled in a single operation instead of voxel by voxel.
+	if (Region.LowerZ > GroundLevel)
 	{
-		for (int y = Region.LowerY; y < Region.UpperY; y++)
-		{
-			for (int z = Region.LowerZ; z < Region.UpperZ; z++)
-			{
-				if (z > GroundLevel)
-				{
-					break;
-				}
-				FVoxel voxel = FVoxel::MakeVoxel(VoxelMaterial, true);
-				Chunk->SetVoxelByCoordinatesWorldSpace(x, y, z, voxel);
-			}
-		}
+		// Nothing to add
+		return;
+	}
+
+	const FVoxel ground = FVoxel::MakeVoxel(VoxelMaterial, true);
+	if (Region.UpperZ - 1 <= GroundLevel)
+	{
+		Chunk->SetUniform(ground);
+	}
+	else
+	{
+		Chunk->FillSlab(0, GroundLevel - Region.LowerZ, ground);
 	}
 }
@@ -1,6 +1,7 @@
 // Fill out your copyright notice in the Description page of Project Settings.
 
 #include "PolyVoxPrivatePCH.h"
+#include "PagedChunkData.h"
 #include "InfiniteNoisePager.h"
 
 UInfiniteNoisePager::UInfiniteNoisePager()
@@ -64,68 +65,151 @@ UInfiniteNoisePager::UInfiniteNoisePager()
 	BiomeNoiseSettings.Add(17, subtropicalDesertSettings);
 
 	bGenerateNewBiomes = true;
+	ColumnTileCacheSize = 1024;
 }
 
-void UInfiniteNoisePager::PageIn_Implementation(const FRegion& Region, APagedChunk* Chunk)
+void UInfiniteNoisePager::InvalidateColumnCache()
 {
-	int32 regionDepth = URegionHelper::GetDepthInCells(Region);
+	ColumnTiles.Empty();
+}
+
+#if WITH_EDITOR
+void UInfiniteNoisePager::PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent)
+{
+	Super::PostEditChangeProperty(PropertyChangedEvent);
+
+	// The columns were worked out from the old settings
+	InvalidateColumnCache();
+}
+#endif
+
+void UInfiniteNoisePager::PageIn(const FRegion& Region, FPagedChunkData* Chunk)
+{
+	ColumnTiles.SetMaxTiles(ColumnTileCacheSize);
+	FNoiseGeneratorMap noiseGenerators;
+	FillChunk(Region, Chunk, noiseGenerators);
+}
+
+void UInfiniteNoisePager::PageInBatch(const TArray<FPagedChunkData*>& Chunks)
+{
+	// Neighbouring chunks nearly always share their biomes and seed, so each generator only gets set up once
+	ColumnTiles.SetMaxTiles(ColumnTileCacheSize);
+	FNoiseGeneratorMap noiseGenerators;
+	for (int32 i = 0; i < Chunks.Num(); i++)
+	{
+		FillChunk(Chunks[i]->ChunkRegion, Chunks[i], noiseGenerators);
+	}
+}
+
+void UInfiniteNoisePager::FillChunk(const FRegion& Region, FPagedChunkData* Chunk, FNoiseGeneratorMap& NoiseGenerators)
+{
+	FColumnTilePtr tile = GetColumnTile(Region, Chunk, NoiseGenerators);
+	const int32 regionWidth = Region.UpperX - Region.LowerX;
+	const int32 regionHeight = Region.UpperY - Region.LowerY;
+	const int32 regionDepth = Region.UpperZ - Region.LowerZ;
+	int32 regionDepthInCells = URegionHelper::GetDepthInCells(Region);
+
+	// Work out how far up the chunk each column is solid (-1 if not at all), so chunks which are entirely above or
+	// below the surface can be filled without touching individual voxels
+	TArray<int32> columnTops;
+	columnTops.SetNumUninitialized(regionWidth * regionHeight);
+	int32 lowestTop = regionDepth;
+	int32 highestTop = -1;
+	bool bSingleMaterial = true;
+	for (int32 i = 0; i < columnTops.Num(); i++)
+	{
+		const FColumnSample& column = tile->Columns[i];
+		const int32 targetHeight = FMath::RoundToInt(regionDepthInCells * column.Height);
+		columnTops[i] = FMath::Clamp(targetHeight, -1, regionDepth - 1);
+		lowestTop = FMath::Min(lowestTop, columnTops[i]);
+		highestTop = FMath::Max(highestTop, columnTops[i]);
+		bSingleMaterial &= column.Material == tile->Columns[0].Material;
+	}
+
+	if (highestTop < 0)
+	{
+		// Chunks are handed to us as empty air already
+		return;
+	}
+	if (lowestTop == regionDepth - 1 && bSingleMaterial)
+	{
+		Chunk->SetUniform(FVoxel::MakeVoxel(tile->Columns[0].Material, true));
+		return;
+	}
+
+	// Otherwise build the chunk a column at a time in a linear buffer and hand it over in one go
+	TArray<FVoxel> voxels;
+	voxels.Init(FVoxel::GetEmptyVoxel(), regionWidth * regionHeight * regionDepth);
+	const int32 sliceSize = regionWidth * regionHeight;
+	for (int32 i = 0; i < columnTops.Num(); i++)
+	{
+		const FVoxel solidVoxel = FVoxel::MakeVoxel(tile->Columns[i].Material, true);
+		for (int32 z = 0, index = i; z <= columnTops[i]; z++, index += sliceSize)
+		{
+			voxels[index] = solidVoxel;
+		}
+	}
+	Chunk->CopyFromLinear(voxels);
+}
+
+FColumnTilePtr UInfiniteNoisePager::GetColumnTile(const FRegion& Region, FPagedChunkData* Chunk, FNoiseGeneratorMap& NoiseGenerators)
+{
+	// Every chunk in a stack shares its columns, so only the first one to be paged in has to work them out
+	const FIntVector& chunkPosition = Chunk->GetChunkSpacePosition();
+	FColumnTilePtr cachedTile = ColumnTiles.Find(chunkPosition.X, chunkPosition.Y, Chunk->RandomSeed);
+	if (cachedTile.IsValid())
+	{
+		return cachedTile;
+	}
+
+	const int32 regionWidth = Region.UpperX - Region.LowerX;
+	TSharedPtr<FColumnTile, ESPMode::ThreadSafe> tile = MakeShareable(new FColumnTile());
+	tile->Columns.SetNumUninitialized(regionWidth * (Region.UpperY - Region.LowerY));
+	bool bMissingSettings = false;
 	for (int x = Region.LowerX; x < Region.UpperX; x++)
 	{
 		for (int y = Region.LowerY; y < Region.UpperY; y++)
 		{
+			// Chunks are always empty air when they are handed to us, so there's no existing terrain to take the biome from
 			uint8 chunkBiome = 0;
-
-			FVoxel bottomVoxel = Chunk->GetVoxelByCoordinatesWorldSpace(x, y, Region.LowerZ);
-			if (bottomVoxel.bIsSolid)
-			{
-				// The bottom voxel is solid, so iterate over the rest of the region
-				FVoxel currentVoxel = bottomVoxel;
-				for (int z = Region.LowerZ; z < Region.UpperZ - 1; z++)
-				{
-					FVoxel nextVoxel = Chunk->GetVoxelByCoordinatesWorldSpace(x, y, z + 1);
-					if (!nextVoxel.bIsSolid)
-					{
-						// Next voxel is air, so set the biome to the top voxel
-						chunkBiome = currentVoxel.Material;
-						break;
-					}
-					currentVoxel = nextVoxel;
-				}
-			}
-			else if(bGenerateNewBiomes)
+			if (bGenerateNewBiomes)
 			{
-				// No bottom voxel, so we need to generate a biome
 				unimplemented();
 				// TODO: Generate new biome based off of noise generator
 			}
-			
 
-			FVoxelNoiseSettings* currentSettings = BiomeNoiseSettings.Find(chunkBiome);
-			if (currentSettings == NULL)
-			{
-				UE_LOG(LogPolyVox, Warning, TEXT("No voxel settings for material %d!"), chunkBiome);
-				break;
-			}
-			FVoxelNoiseSettings biomeSettings = *currentSettings;
-			biomeSettings.Seed = Chunk->RandomSeed;
+			FColumnSample& column = tile->Columns[(x - Region.LowerX) + (y - Region.LowerY) * regionWidth];
+			column.Material = chunkBiome;
+			column.Biome = chunkBiome;
 
-			PolyVoxNoise noiseGen;
-			noiseGen.SetNoiseSettings(biomeSettings);
-
-			float elevation = noiseGen.GetNoise((float)x, (float)y);
-
-			int32 targetHeight = Region.LowerZ + FMath::RoundToInt(regionDepth * elevation);
-			for (int z = Region.LowerZ; z < Region.UpperZ; z++)
+			// Setting up a generator shuffles its whole permutation table, so they're shared between columns
+			const FIntPoint generatorKey(Chunk->RandomSeed, chunkBiome);
+			TUniquePtr<PolyVoxNoise>* noiseGen = NoiseGenerators.Find(generatorKey);
+			if (noiseGen == NULL)
 			{
-				if (z <= targetHeight)
+				FVoxelNoiseSettings* currentSettings = BiomeNoiseSettings.Find(chunkBiome);
+				if (currentSettings == NULL)
 				{
-					Chunk->SetVoxelByCoordinatesWorldSpace(x, y, z, FVoxel::MakeVoxel(chunkBiome, true));
-				}
-				else
-				{
-					Chunk->SetVoxelByCoordinatesWorldSpace(x, y, z, FVoxel::GetEmptyVoxel());
+					if (!bMissingSettings)
+					{
+						UE_LOG(LogPolyVox, Warning, TEXT("No voxel settings for material %d!"), chunkBiome);
+						bMissingSettings = true;
+					}
+					// Below anything the noise can return, so the column is left empty
+					column.Height = -2.0f;
+					continue;
 				}
+				FVoxelNoiseSettings biomeSettings = *currentSettings;
+				biomeSettings.Seed = Chunk->RandomSeed;
+
+				noiseGen = &NoiseGenerators.Add(generatorKey, MakeUnique<PolyVoxNoise>());
+				(*noiseGen)->SetNoiseSettings(biomeSettings);
 			}
+
+			column.Height = (*noiseGen)->GetNoise((float)x, (float)y);
 		}
 	}
+
+	ColumnTiles.Add(chunkPosition.X, chunkPosition.Y, Chunk->RandomSeed, tile);
+	return tile;
 }
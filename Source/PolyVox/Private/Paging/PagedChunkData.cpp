@@ -0,0 +1,832 @@
+/*******************************************************************************
+The MIT License (MIT)
+
+Copyright (c) 2015 David Williams and Matthew Williams
+Modified for use in Unreal Engine 4 by Jay Stevens
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*******************************************************************************/
+
+#include "PolyVoxPrivatePCH.h"
+#include "Utils/Morton.h"
+#include "Pager.h"
+#include "ChunkBufferPool.h"
+#include "PagedChunk.h"
+#include "PagedChunkData.h"
+
+FPagedChunkData::FPagedChunkData()
+{
+	RandomSeed = 123;
+	bDataModified = false;
+	bNeedsNewMarchingCubesMesh = false;
+	EditVersion = 0;
+	bWantsMesh = false;
+	bIsPagingIn = false;
+	bIsCompressed = false;
+	LastAccessTick = 0;
+	LessRecentlyUsed = nullptr;
+	MoreRecentlyUsed = nullptr;
+	SideLength = 0;
+	SideLengthPower = 0;
+	Pager = nullptr;
+	BufferPool = nullptr;
+	SolidVoxelCount = 0;
+	bSolidityStale = false;
+	BrickSideLengthPower = 0;
+	BricksPerSidePower = 0;
+	ChunkSpacePosition = FIntVector::ZeroValue;
+}
+
+FPagedChunkData::~FPagedChunkData()
+{
+	// The pager may well have been garbage collected by the time this runs, so anything which needs saving
+	// must have been removed through RemoveChunk() already.
+	FreeData();
+}
+
+void FPagedChunkData::RemoveChunk()
+{
+	if (bDataModified && Pager)
+	{
+		// The pager expects to be able to read voxels
+		Decompress();
+		// Page the data out
+		Pager->PageOut(ChunkRegion, this);
+
+		bDataModified = false;
+	}
+	FreeData();
+}
+
+bool FPagedChunkData::IsModified() const
+{
+	return bDataModified;
+}
+
+void FPagedChunkData::FreeData()
+{
+	VoxelData.Empty();
+	FreeSolidity();
+	CompressedData.Empty();
+	bIsCompressed = false;
+}
+
+void FPagedChunkData::InitChunk(const FIntVector& Position, uint8 ChunkSideLength, UPager* VoxelPager /*= nullptr*/, int32 Seed /*= 123*/, FChunkBufferPool* Pool /*= nullptr*/, const TArray<uint8>* SavedVoxels /*= nullptr*/)
+{
+	if (!PrepareForPageIn(Position, ChunkSideLength, VoxelPager, Seed, Pool))
+	{
+		return;
+	}
+
+	// Page the data in, unless we've been handed a copy of it already
+	if (SavedVoxels == NULL || !DeserializeVoxels(*SavedVoxels))
+	{
+		Pager->PageIn(ChunkRegion, this);
+	}
+	FinishPageIn();
+}
+
+bool FPagedChunkData::PrepareForPageIn(const FIntVector& Position, uint8 ChunkSideLength, UPager* VoxelPager, int32 Seed, FChunkBufferPool* Pool)
+{
+	ChunkSpacePosition = Position;
+	RandomSeed = Seed;
+	SideLength = ChunkSideLength;
+	SideLengthPower = FMath::Log2(SideLength);
+	BrickSideLengthPower = FMath::Min(SideLengthPower, BRICK_SIDE_LENGTH_POWER);
+	BricksPerSidePower = SideLengthPower - BrickSideLengthPower;
+	Pager = VoxelPager;
+	bDataModified = true;
+	bIsPagingIn = true;
+	VoxelData.Empty();
+	FreeSolidity();
+	CompressedData.Empty();
+	bIsCompressed = false;
+
+	BufferPool = Pool;
+	VoxelData.SetBufferPool(BufferPool);
+
+	if (Pager == NULL)
+	{
+		UE_LOG(LogPolyVox, Fatal, TEXT("No pager was given to the chunk!"));
+		return false;
+	}
+
+	// Set up the data. This starts out as a uniform chunk of empty voxels, which needs no storage until something different is written.
+	VoxelData.Init(SideLength * SideLength * SideLength);
+
+	// Pass the chunk to the Pager to give it a chance to initialize it with any data
+	// From the coordinates of the chunk we deduce the coordinates of the contained voxels.
+	const FIntVector lower = ChunkSpacePosition * (int32)SideLength;
+	ChunkRegion = URegionHelper::CreateRegionFromInt(lower.X, lower.Y, lower.Z, lower.X + SideLength, lower.Y + SideLength, lower.Z + SideLength);
+	return true;
+}
+
+void FPagedChunkData::FinishPageIn()
+{
+	// The pager may have overwritten some values entirely, so there's no point keeping them in the palette.
+	VoxelData.Compact();
+	// Writes through SetVoxel() and the bulk fills keep the solidity plane up to date, so most chunks don't need it
+	// rebuilt. SetDataAtIndex() and DeserializeVoxels() replace voxels behind its back and mark it stale instead.
+	if (bSolidityStale || VoxelData.IsUniform() || SolidityWords.Num() == 0)
+	{
+		RebuildSolidity();
+	}
+	checkfSlow(VoxelData.IsUniform() || SolidityWords.Num() > 0, TEXT("Chunk (%d, %d, %d) finished paging in without a solidity plane."), ChunkSpacePosition.X, ChunkSpacePosition.Y, ChunkSpacePosition.Z);
+
+	// We'll use this later to decide if data needs to be paged out again.
+	bDataModified = false;
+	bIsPagingIn = false;
+	MarkAllDirty();
+}
+
+int32 FPagedChunkData::GetDataSizeInBytes() const
+{
+	if (bIsCompressed)
+	{
+		return CompressedData.Num();
+	}
+	return VoxelData.GetSizeInBytes() + SolidityWords.Num() * sizeof(uint64) + BrickSolidCounts.Num() * sizeof(uint16) + MixedBrickMask.Num() * sizeof(uint64);
+}
+
+FVoxel FPagedChunkData::GetVoxelByCoordinatesWorldSpace(int32 XPos, int32 YPos, int32 ZPos) const
+{
+	checkf(XPos >= ChunkRegion.LowerX, TEXT("Wrong chunk! Supplied x position %d is outside of the chunk boundaries %d"), XPos, ChunkRegion.LowerX);
+	checkf(YPos >= ChunkRegion.LowerY, TEXT("Wrong chunk! Supplied y position %d is outside of the chunk boundaries %d"), YPos, ChunkRegion.LowerY);
+	checkf(ZPos >= ChunkRegion.LowerZ, TEXT("Wrong chunk! Supplied z position %d is outside of the chunk boundaries %d"), ZPos, ChunkRegion.LowerZ);
+	return GetVoxelByCoordinatesChunkSpace(XPos - ChunkRegion.LowerX, YPos - ChunkRegion.LowerY, ZPos - ChunkRegion.LowerZ);
+}
+
+FVoxel FPagedChunkData::GetVoxelByCoordinatesChunkSpace(int32 XPos, int32 YPos, int32 ZPos) const
+{
+	// This code is not usually expected to be called by the user, with the exception of when implementing paging 
+	// of uncompressed data. It's a performance critical code path so we use asserts rather than exceptions.
+	checkf(XPos < SideLength, TEXT("Supplied x position %d is outside of the chunk boundaries %d"), XPos, SideLength);
+	checkf(YPos < SideLength, TEXT("Supplied y position %d is outside of the chunk boundaries %d"), YPos, SideLength);
+	checkf(ZPos < SideLength, TEXT("Supplied z position %d is outside of the chunk boundaries %d"), ZPos, SideLength);
+	checkf(VoxelData.Num() > 0, TEXT("No uncompressed data - chunk must be decompressed before accessing voxels."));
+
+	uint32 index = morton256_x[XPos] | morton256_y[YPos] | morton256_z[ZPos];
+
+	checkf(index < (uint32)VoxelData.Num(), TEXT("Morton index %d out of bounds of voxel data size %d! Trying to access (%d, %d, %d)."), index, VoxelData.Num(), XPos, YPos, ZPos);
+
+	return VoxelData.Get(index);
+}
+
+void FPagedChunkData::SetVoxelByCoordinatesWorldSpace(int32 XPos, int32 YPos, int32 ZPos, FVoxel Value)
+{
+	checkf(XPos >= ChunkRegion.LowerX, TEXT("Wrong chunk! Supplied x position %d is outside of the chunk boundaries %d"), XPos, ChunkRegion.LowerX);
+	checkf(YPos >= ChunkRegion.LowerY, TEXT("Wrong chunk! Supplied y position %d is outside of the chunk boundaries %d"), YPos, ChunkRegion.LowerY);
+	checkf(ZPos >= ChunkRegion.LowerZ, TEXT("Wrong chunk! Supplied z position %d is outside of the chunk boundaries %d"), ZPos, ChunkRegion.LowerZ);
+	SetVoxelByCoordinatesChunkSpace(XPos - ChunkRegion.LowerX, YPos - ChunkRegion.LowerY, ZPos - ChunkRegion.LowerZ, Value);
+}
+
+void FPagedChunkData::SetVoxelByCoordinatesChunkSpace(int32 XPos, int32 YPos, int32 ZPos, FVoxel Value)
+{
+	bool bBecameDirty;
+	SetVoxel(XPos, YPos, ZPos, Value, bBecameDirty);
+}
+
+bool FPagedChunkData::SetVoxel(int32 XPos, int32 YPos, int32 ZPos, FVoxel Value, bool& bOutBecameDirty)
+{
+	bOutBecameDirty = false;
+	if (!WriteVoxel(XPos, YPos, ZPos, Value))
+	{
+		return false;
+	}
+
+	const FIntVector position(XPos, YPos, ZPos);
+	bOutBecameDirty = MarkDirty(position, position);
+	return true;
+}
+
+bool FPagedChunkData::WriteVoxel(int32 XPos, int32 YPos, int32 ZPos, FVoxel Value)
+{
+	// This code is not usually expected to be called by the user, with the exception of when implementing paging 
+	// of uncompressed data. It's a performance critical code path so we use asserts rather than exceptions.
+	checkf(XPos < SideLength, TEXT("Supplied x position %d is outside of the chunk boundaries %d"), XPos, SideLength);
+	checkf(YPos < SideLength, TEXT("Supplied y position %d is outside of the chunk boundaries %d"), YPos, SideLength);
+	checkf(ZPos < SideLength, TEXT("Supplied z position %d is outside of the chunk boundaries %d"), ZPos, SideLength);
+	checkf(VoxelData.Num() > 0, TEXT("No uncompressed data - chunk must be decompressed before accessing voxels."));
+
+	uint32 index = morton256_x[XPos] | morton256_y[YPos] | morton256_z[ZPos];
+
+	checkf(index < (uint32)VoxelData.Num(), TEXT("Morton index %d out of bounds of voxel data size %d! Trying to access (%d, %d, %d)."), index, VoxelData.Num(), XPos, YPos, ZPos);
+
+	const FVoxel oldValue = VoxelData.Get(index);
+	if (oldValue == Value)
+	{
+		// Nothing to do, and no reason to remesh
+		return false;
+	}
+	const bool bWasUniform = VoxelData.IsUniform();
+	const bool bWasSolid = oldValue.bIsSolid;
+	VoxelData.Set(index, Value);
+
+	if (bWasUniform && !VoxelData.IsUniform())
+	{
+		// This is the first differing voxel, so the solidity plane needs to exist now
+		RebuildSolidity();
+	}
+	else if (SolidityWords.Num() > 0 && bWasSolid != Value.bIsSolid)
+	{
+		const uint32 bit = XPos + (YPos << SideLengthPower) + (ZPos << (SideLengthPower * 2));
+		const uint64 mask = 1ull << (bit & 63);
+		if (Value.bIsSolid)
+		{
+			SolidityWords[bit >> 6] |= mask;
+		}
+		else
+		{
+			SolidityWords[bit >> 6] &= ~mask;
+		}
+		UpdateBrickOccupancy(XPos, YPos, ZPos, Value.bIsSolid);
+	}
+
+	bDataModified = true;
+	return true;
+}
+
+FVoxel FPagedChunkData::GetDataAtIndex(const int32 CurrentVoxelIndex) const
+{
+	if (CurrentVoxelIndex < 0 || CurrentVoxelIndex >= VoxelData.Num())
+	{
+		UE_LOG(LogPolyVox, Warning, TEXT("Current voxel index %d was out of range!"), CurrentVoxelIndex);
+		return FVoxel::GetEmptyVoxel();
+	}
+	return VoxelData.Get(CurrentVoxelIndex);
+}
+
+void FPagedChunkData::SetDataAtIndex(const int32 CurrentVoxelIndex, FVoxel Value)
+{
+	if (CurrentVoxelIndex < 0 || CurrentVoxelIndex >= VoxelData.Num())
+	{
+		UE_LOG(LogPolyVox, Warning, TEXT("Current voxel index %d was out of range!"), CurrentVoxelIndex);
+		return;
+	}
+	VoxelData.Set(CurrentVoxelIndex, Value);
+	bSolidityStale = true;
+	bDataModified = true;
+}
+
+int32 FPagedChunkData::GetVoxelCount() const
+{
+	return VoxelData.Num();
+}
+
+void FPagedChunkData::SetUniform(FVoxel Value)
+{
+	WriteUniform(Value);
+	MarkAllDirty();
+}
+
+// Within a Morton ordered chunk every 64 voxels form a 4x4x4 block, with the voxel's height in that block taken from
+// bits 2 and 5 of its index. This returns the bits of the voxels between two heights (inclusive) in such a block.
+static uint64 GetMortonBlockLayerMask(int32 LowerZ, int32 UpperZ)
+{
+	uint64 mask = 0;
+	for (uint32 bit = 0; bit < 64; bit++)
+	{
+		const int32 z = (int32)(((bit >> 2) & 1) | (((bit >> 5) & 1) << 1));
+		if (z >= LowerZ && z <= UpperZ)
+		{
+			mask |= 1ull << bit;
+		}
+	}
+	return mask;
+}
+
+void FPagedChunkData::FillSlab(int32 LowerZ, int32 UpperZ, FVoxel Value)
+{
+	checkf(VoxelData.Num() > 0, TEXT("Chunk must be initialized before it can be filled."));
+	LowerZ = FMath::Max(LowerZ, 0);
+	UpperZ = FMath::Min(UpperZ, SideLength - 1);
+	if (LowerZ > UpperZ)
+	{
+		return;
+	}
+	else if (LowerZ == 0 && UpperZ == SideLength - 1)
+	{
+		SetUniform(Value);
+		return;
+	}
+	const bool bWasUniform = VoxelData.IsUniform();
+	const bool bWasSolid = VoxelData.Get(0).bIsSolid;
+	if (bWasUniform && VoxelData.Get(0) == Value)
+	{
+		// Nothing to change
+		return;
+	}
+
+	// Work out which voxels are in the slab, in storage order
+	TArray<uint64> mask;
+	mask.SetNumZeroed((VoxelData.Num() + 63) >> 6);
+	if (SideLength >= 4)
+	{
+		for (int32 blockZ = LowerZ & ~3; blockZ <= UpperZ; blockZ += 4)
+		{
+			const uint64 layerMask = GetMortonBlockLayerMask(LowerZ - blockZ, UpperZ - blockZ);
+			for (int32 blockY = 0; blockY < SideLength; blockY += 4)
+			{
+				for (int32 blockX = 0; blockX < SideLength; blockX += 4)
+				{
+					mask[(morton256_x[blockX] | morton256_y[blockY] | morton256_z[blockZ]) >> 6] = layerMask;
+				}
+			}
+		}
+	}
+	else
+	{
+		// Tiny chunks don't fill a single block
+		for (int32 z = LowerZ; z <= UpperZ; z++)
+		{
+			for (int32 y = 0; y < SideLength; y++)
+			{
+				for (int32 x = 0; x < SideLength; x++)
+				{
+					const uint32 index = morton256_x[x] | morton256_y[y] | morton256_z[z];
+					mask[index >> 6] |= 1ull << (index & 63);
+				}
+			}
+		}
+	}
+	VoxelData.SetMasked(mask, Value);
+
+	if (bWasUniform)
+	{
+		// We know exactly what the chunk looks like now, so the solidity plane can be filled in a layer at a time
+		const uint32 layerSize = (uint32)SideLength * SideLength;
+		AllocateSolidity();
+		if (bWasSolid)
+		{
+			SetSolidityBits(0, (uint32)VoxelData.Num(), true);
+		}
+		SetSolidityBits(LowerZ * layerSize, (UpperZ + 1) * layerSize, Value.bIsSolid);
+		RebuildBrickOccupancy();
+	}
+	else
+	{
+		RebuildSolidity();
+	}
+
+	bDataModified = true;
+	MarkDirty(FIntVector(0, 0, LowerZ), FIntVector(SideLength - 1, SideLength - 1, UpperZ));
+}
+
+void FPagedChunkData::CopyFromLinear(const TArray<FVoxel>& Voxels)
+{
+	checkf(VoxelData.Num() > 0, TEXT("Chunk must be initialized before it can be filled."));
+	checkf(Voxels.Num() == VoxelData.Num(), TEXT("Tried to copy %d voxels into a chunk of %d."), Voxels.Num(), VoxelData.Num());
+
+	TArray<FVoxel> mortonOrdered;
+	mortonOrdered.SetNumUninitialized(Voxels.Num());
+	int32 linearIndex = 0;
+	for (int32 z = 0; z < SideLength; z++)
+	{
+		for (int32 y = 0; y < SideLength; y++)
+		{
+			const uint32 rowIndex = morton256_y[y] | morton256_z[z];
+			for (int32 x = 0; x < SideLength; x++, linearIndex++)
+			{
+				mortonOrdered[morton256_x[x] | rowIndex] = Voxels[linearIndex];
+			}
+		}
+	}
+	VoxelData.SetAll(mortonOrdered.GetData());
+
+	// The solidity plane is in the same order as the buffer, so it can be built straight from it
+	if (VoxelData.IsUniform())
+	{
+		FreeSolidity();
+	}
+	else
+	{
+		AllocateSolidity();
+		for (int32 i = 0; i < Voxels.Num(); i++)
+		{
+			if (Voxels[i].bIsSolid)
+			{
+				SolidityWords[i >> 6] |= 1ull << (i & 63);
+			}
+		}
+		RebuildBrickOccupancy();
+	}
+
+	bDataModified = true;
+	MarkAllDirty();
+}
+
+void FPagedChunkData::CopyToLinear(TArray<FVoxel>& OutVoxels) const
+{
+	checkf(VoxelData.Num() > 0, TEXT("No uncompressed data - chunk must be decompressed before accessing voxels."));
+
+	OutVoxels.SetNumUninitialized(VoxelData.Num());
+	int32 linearIndex = 0;
+	for (int32 z = 0; z < SideLength; z++)
+	{
+		for (int32 y = 0; y < SideLength; y++)
+		{
+			const uint32 rowIndex = morton256_y[y] | morton256_z[z];
+			for (int32 x = 0; x < SideLength; x++, linearIndex++)
+			{
+				OutVoxels[linearIndex] = VoxelData.GetUnchecked(morton256_x[x] | rowIndex);
+			}
+		}
+	}
+}
+
+void FPagedChunkData::FinishBulkWrite()
+{
+	RebuildSolidity();
+	bDataModified = true;
+}
+
+void FPagedChunkData::WriteUniform(FVoxel Value)
+{
+	checkf(VoxelData.Num() > 0, TEXT("Chunk must be initialized before it can be filled."));
+	VoxelData.Init(VoxelData.Num(), Value);
+	FreeSolidity();
+
+	bDataModified = true;
+}
+
+bool FPagedChunkData::MarkDirty(const FIntVector& Lower, const FIntVector& Upper)
+{
+	checkf(Lower.X <= Upper.X && Lower.Y <= Upper.Y && Lower.Z <= Upper.Z, TEXT("Dirty region (%d, %d, %d) to (%d, %d, %d) is inverted."), Lower.X, Lower.Y, Lower.Z, Upper.X, Upper.Y, Upper.Z);
+	if (bIsPagingIn)
+	{
+		// FinishPageIn() dirties the whole chunk once the pager is done with it
+		return false;
+	}
+	FScopeLock lock(&DirtyRegionLock);
+	EditVersion++;
+	if (!bNeedsNewMarchingCubesMesh)
+	{
+		DirtyLower = Lower;
+		DirtyUpper = Upper;
+		bNeedsNewMarchingCubesMesh = true;
+		return true;
+	}
+
+	DirtyLower.X = FMath::Min(DirtyLower.X, Lower.X);
+	DirtyLower.Y = FMath::Min(DirtyLower.Y, Lower.Y);
+	DirtyLower.Z = FMath::Min(DirtyLower.Z, Lower.Z);
+	DirtyUpper.X = FMath::Max(DirtyUpper.X, Upper.X);
+	DirtyUpper.Y = FMath::Max(DirtyUpper.Y, Upper.Y);
+	DirtyUpper.Z = FMath::Max(DirtyUpper.Z, Upper.Z);
+	return false;
+}
+
+void FPagedChunkData::MarkAllDirty()
+{
+	MarkDirty(FIntVector(0, 0, 0), FIntVector(SideLength, SideLength, SideLength));
+}
+
+bool FPagedChunkData::NeedsNewMarchingCubesMesh() const
+{
+	return bNeedsNewMarchingCubesMesh;
+}
+
+bool FPagedChunkData::GetDirtyRegion(FIntVector& OutLower, FIntVector& OutUpper) const
+{
+	FScopeLock lock(&DirtyRegionLock);
+	if (!bNeedsNewMarchingCubesMesh)
+	{
+		return false;
+	}
+	OutLower = DirtyLower;
+	OutUpper = DirtyUpper;
+	return true;
+}
+
+void FPagedChunkData::ClearDirtyRegion()
+{
+	FScopeLock lock(&DirtyRegionLock);
+	bNeedsNewMarchingCubesMesh = false;
+}
+
+uint32 FPagedChunkData::GetEditVersion() const
+{
+	return EditVersion;
+}
+
+bool FPagedChunkData::IsUniform() const
+{
+	return VoxelData.IsUniform();
+}
+
+FVoxel FPagedChunkData::GetUniformVoxel() const
+{
+	return VoxelData.Get(0);
+}
+
+bool FPagedChunkData::Compress()
+{
+	if (bIsCompressed || VoxelData.Num() == 0)
+	{
+		return false;
+	}
+	VoxelData.CompressRLE(CompressedData);
+	if (CompressedData.Num() >= GetDataSizeInBytes())
+	{
+		CompressedData.Empty();
+		return false;
+	}
+	VoxelData.Empty();
+	FreeSolidity();
+	bIsCompressed = true;
+	return true;
+}
+
+void FPagedChunkData::Decompress()
+{
+	if (!bIsCompressed)
+	{
+		return;
+	}
+	bool bDecompressed = VoxelData.DecompressRLE(CompressedData, SideLength * SideLength * SideLength);
+	checkf(bDecompressed, TEXT("Compressed data for chunk (%d, %d, %d) is corrupt!"), ChunkSpacePosition.X, ChunkSpacePosition.Y, ChunkSpacePosition.Z);
+	CompressedData.Empty();
+	bIsCompressed = false;
+	RebuildSolidity();
+}
+
+bool FPagedChunkData::IsCompressed() const
+{
+	return bIsCompressed;
+}
+
+void FPagedChunkData::SerializeVoxels(TArray<uint8>& OutBytes) const
+{
+	if (bIsCompressed)
+	{
+		OutBytes = CompressedData;
+	}
+	else
+	{
+		VoxelData.CompressRLE(OutBytes);
+	}
+}
+
+bool FPagedChunkData::DeserializeVoxels(const TArray<uint8>& Bytes)
+{
+	checkf(!bIsCompressed, TEXT("Chunk must be decompressed before replacing its voxels."));
+	const int32 voxelCount = SideLength * SideLength * SideLength;
+	if (!VoxelData.DecompressRLE(Bytes, voxelCount))
+	{
+		VoxelData.Init(voxelCount);
+		return false;
+	}
+	// None of the solidity plane matches the new voxels
+	bSolidityStale = true;
+	return true;
+}
+
+uint64 FPagedChunkData::GetSolidityBitsAlongX(int32 XPos, int32 YPos, int32 ZPos, int32 Count) const
+{
+	checkf(Count > 0 && Count <= 64, TEXT("Can only fetch between 1 and 64 solidity bits at once, not %d."), Count);
+	checkf(XPos + Count <= SideLength, TEXT("Solidity row (%d + %d) runs off the end of the chunk (%d)."), XPos, Count, SideLength);
+	checkf(!bIsCompressed, TEXT("Chunk must be decompressed before accessing voxels."));
+
+	const uint64 countMask = Count == 64 ? ~0ull : ((1ull << Count) - 1);
+	if (SolidityWords.Num() == 0)
+	{
+		return VoxelData.Get(0).bIsSolid ? countMask : 0;
+	}
+
+	const uint32 bit = XPos + (YPos << SideLengthPower) + (ZPos << (SideLengthPower * 2));
+	const uint32 word = bit >> 6;
+	const uint32 offset = bit & 63;
+	uint64 bits = SolidityWords[word] >> offset;
+	if (offset + Count > 64)
+	{
+		// The row straddles two words
+		bits |= SolidityWords[word + 1] << (64 - offset);
+	}
+	return bits & countMask;
+}
+
+const TArray<uint64>& FPagedChunkData::GetSolidityWords() const
+{
+	return SolidityWords;
+}
+
+uint8 FPagedChunkData::GetBrickSideLengthPower() const
+{
+	return BrickSideLengthPower;
+}
+
+EBrickOccupancy FPagedChunkData::GetBrickOccupancy(int32 BrickX, int32 BrickY, int32 BrickZ) const
+{
+	checkf(!bIsCompressed, TEXT("Chunk must be decompressed before accessing voxels."));
+	if (BrickSolidCounts.Num() == 0)
+	{
+		// Uniform chunk
+		return VoxelData.Get(0).bIsSolid ? EBrickOccupancy::AllSolid : EBrickOccupancy::AllAir;
+	}
+
+	const int32 brickIndex = BrickX + (BrickY << BricksPerSidePower) + (BrickZ << (BricksPerSidePower * 2));
+	const uint16 solidCount = BrickSolidCounts[brickIndex];
+	if (solidCount == 0)
+	{
+		return EBrickOccupancy::AllAir;
+	}
+	else if (solidCount == (1 << (BrickSideLengthPower * 3)))
+	{
+		return EBrickOccupancy::AllSolid;
+	}
+	return EBrickOccupancy::Mixed;
+}
+
+const TArray<uint64>& FPagedChunkData::GetMixedBrickMask() const
+{
+	return MixedBrickMask;
+}
+
+bool FPagedChunkData::IsAllAir() const
+{
+	if (BrickSolidCounts.Num() == 0)
+	{
+		return !VoxelData.Get(0).bIsSolid;
+	}
+	return SolidVoxelCount == 0;
+}
+
+bool FPagedChunkData::IsAllSolid() const
+{
+	if (BrickSolidCounts.Num() == 0)
+	{
+		return VoxelData.Get(0).bIsSolid;
+	}
+	return SolidVoxelCount == VoxelData.Num();
+}
+
+void FPagedChunkData::UpdateBrickOccupancy(int32 XPos, int32 YPos, int32 ZPos, bool bIsSolid)
+{
+	const int32 brickIndex = (XPos >> BrickSideLengthPower) + ((YPos >> BrickSideLengthPower) << BricksPerSidePower) + ((ZPos >> BrickSideLengthPower) << (BricksPerSidePower * 2));
+	uint16& solidCount = BrickSolidCounts[brickIndex];
+	if (bIsSolid)
+	{
+		solidCount++;
+		SolidVoxelCount++;
+	}
+	else
+	{
+		solidCount--;
+		SolidVoxelCount--;
+	}
+
+	const uint64 mask = 1ull << (brickIndex & 63);
+	if (solidCount == 0 || solidCount == (1 << (BrickSideLengthPower * 3)))
+	{
+		MixedBrickMask[brickIndex >> 6] &= ~mask;
+	}
+	else
+	{
+		MixedBrickMask[brickIndex >> 6] |= mask;
+	}
+}
+
+void FPagedChunkData::FreeSolidity()
+{
+	if (BufferPool != nullptr)
+	{
+		BufferPool->Release(SolidityWords);
+	}
+	else
+	{
+		SolidityWords.Empty();
+	}
+	BrickSolidCounts.Empty();
+	MixedBrickMask.Empty();
+	SolidVoxelCount = 0;
+	bSolidityStale = false;
+}
+
+void FPagedChunkData::RebuildSolidity()
+{
+	FreeSolidity();
+	if (VoxelData.Num() == 0 || VoxelData.IsUniform())
+	{
+		return;
+	}
+
+	AllocateSolidity();
+	uint32 bit = 0;
+	for (int32 z = 0; z < SideLength; z++)
+	{
+		for (int32 y = 0; y < SideLength; y++)
+		{
+			for (int32 x = 0; x < SideLength; x++, bit++)
+			{
+				if (VoxelData.Get(morton256_x[x] | morton256_y[y] | morton256_z[z]).bIsSolid)
+				{
+					SolidityWords[bit >> 6] |= 1ull << (bit & 63);
+				}
+			}
+		}
+	}
+	RebuildBrickOccupancy();
+}
+
+void FPagedChunkData::RebuildBrickOccupancy()
+{
+	// Count the solid voxels in each brick from the solidity plane, a brick-wide run of bits at a time
+	const int32 bricksPerSide = 1 << BricksPerSidePower;
+	const int32 brickSideLength = 1 << BrickSideLengthPower;
+	const int32 brickCount = bricksPerSide * bricksPerSide * bricksPerSide;
+	BrickSolidCounts.SetNumZeroed(brickCount);
+	MixedBrickMask.SetNumZeroed((brickCount + 63) >> 6);
+	// Bricks are at most 8 voxels wide and always line up with them, so a run never straddles two words
+	const uint64 runMask = (1ull << brickSideLength) - 1;
+	uint32 bit = 0;
+	for (int32 z = 0; z < SideLength; z++)
+	{
+		for (int32 y = 0; y < SideLength; y++)
+		{
+			const int32 rowBrickIndex = ((y >> BrickSideLengthPower) << BricksPerSidePower) + ((z >> BrickSideLengthPower) << (BricksPerSidePower * 2));
+			for (int32 brickX = 0; brickX < bricksPerSide; brickX++, bit += brickSideLength)
+			{
+				// Most runs are all air or all solid, which don't need their bits counting
+				const uint64 run = (SolidityWords[bit >> 6] >> (bit & 63)) & runMask;
+				const int32 solidInRun = run == 0 ? 0 : (run == runMask ? brickSideLength : FMath::CountBits(run));
+				BrickSolidCounts[rowBrickIndex + brickX] += (uint16)solidInRun;
+				SolidVoxelCount += solidInRun;
+			}
+		}
+	}
+	for (int32 i = 0; i < brickCount; i++)
+	{
+		if (BrickSolidCounts[i] != 0 && BrickSolidCounts[i] != brickSideLength * brickSideLength * brickSideLength)
+		{
+			MixedBrickMask[i >> 6] |= 1ull << (i & 63);
+		}
+	}
+}
+
+void FPagedChunkData::AllocateSolidity()
+{
+	FreeSolidity();
+	if (BufferPool != nullptr)
+	{
+		BufferPool->Acquire((VoxelData.Num() + 63) >> 6, SolidityWords);
+	}
+	else
+	{
+		SolidityWords.SetNumZeroed((VoxelData.Num() + 63) >> 6);
+	}
+}
+
+void FPagedChunkData::SetSolidityBits(uint32 First, uint32 End, bool bIsSolid)
+{
+	while (First < End)
+	{
+		// Work out the bits of this word which are in range, then set or clear them all at once
+		const uint32 bitInWord = First & 63;
+		const uint32 count = FMath::Min(64 - bitInWord, End - First);
+		const uint64 mask = (count == 64 ? ~0ull : ((1ull << count) - 1)) << bitInWord;
+		if (bIsSolid)
+		{
+			SolidityWords[First >> 6] |= mask;
+		}
+		else
+		{
+			SolidityWords[First >> 6] &= ~mask;
+		}
+		First += count;
+	}
+}
+
+const FIntVector& FPagedChunkData::GetChunkSpacePosition() const
+{
+	return ChunkSpacePosition;
+}
+
+APagedChunk* FPagedChunkData::GetMeshActor() const
+{
+	return MeshActor.Get();
+}
+
+int32 FPagedChunkData::CalculateSizeInBytes(uint8 ChunkSideLength)
+{
+	// Note: We disregard the size of the other class members as they are likely to be very small compared to the size of the
+	// allocated voxel data. This also keeps the reported size as a power of two, which makes other memory calculations easier.
+	// Voxels are palette-compressed, so we budget for a typical chunk of up to 16 distinct voxels (4 bits per voxel)
+	// rather than the 2 bytes per voxel an uncompressed chunk would need.
+	return (ChunkSideLength * ChunkSideLength * ChunkSideLength) / 2;
+}
@@ -25,15 +25,123 @@ SOFTWARE.
 
 #include "PolyVoxPrivatePCH.h"
 #include "PagedChunk.h"
+#include "PagedChunkData.h"
 #include "GameFramework/DefaultPawn.h"
 #include "GameFramework/Controller.h"
 #include "Engine/World.h"
 #include "Engine/Texture2D.h"
 #include "Mesh/VoxelProceduralMeshComponent.h"
+#include "Mesh/VolumeSampler.h"
 #include "DrawDebugHelpers.h"
+#include "Async/AsyncWork.h"
+#include "LatentActions.h"
+#include "Engine/LatentActionManager.h"
 #include "Utils/ArrayHelper.h"
 #include "PagedVolumeComponent.h"
 
+// Runs the pager for a batch of chunks on the thread pool, then hands them back to the volume.
+class FChunkPageInTask : public FNonAbandonableTask
+{
+	friend class FAutoDeleteAsyncTask<FChunkPageInTask>;
+public:
+	FChunkPageInTask(UPagedVolumeComponent* PagingVolume, const TArray<FIntVector>& ChunkPositions)
+		: Volume(PagingVolume), Positions(ChunkPositions)
+	{
+	}
+
+	void DoWork()
+	{
+		// If one of these chunks is being saved right now, reading it back before that finishes would give us the old copy
+		for (int32 i = 0; i < Positions.Num(); i++)
+		{
+			Volume->WaitForPageOut(Positions[i]);
+		}
+		TArray<FPagedChunkData*> chunks;
+		Volume->LoadChunks(Positions, chunks);
+		for (int32 i = 0; i < chunks.Num(); i++)
+		{
+			Volume->PagedInChunks.Enqueue(chunks[i]);
+		}
+		// This must come last; once it reaches zero the volume may be destroyed.
+		Volume->PageInsInFlight.Decrement();
+	}
+
+	FORCEINLINE TStatId GetStatId() const
+	{
+		RETURN_QUICK_DECLARE_CYCLE_STAT(FChunkPageInTask, STATGROUP_ThreadPoolAsyncTasks);
+	}
+
+private:
+	UPagedVolumeComponent* Volume;
+	TArray<FIntVector> Positions;
+};
+
+// Pages out the volume's queue of evicted chunks on the thread pool.
+class FChunkPageOutTask : public FNonAbandonableTask
+{
+	friend class FAutoDeleteAsyncTask<FChunkPageOutTask>;
+public:
+	FChunkPageOutTask(UPagedVolumeComponent* PagingVolume)
+		: Volume(PagingVolume)
+	{
+	}
+
+	void DoWork()
+	{
+		Volume->WritePendingPageOuts();
+		// This must come last; once it reaches zero the volume may be destroyed.
+		Volume->PageOutWritersInFlight.Decrement();
+	}
+
+	FORCEINLINE TStatId GetStatId() const
+	{
+		RETURN_QUICK_DECLARE_CYCLE_STAT(FChunkPageOutTask, STATGROUP_ThreadPoolAsyncTasks);
+	}
+
+private:
+	UPagedVolumeComponent* Volume;
+};
+
+// Holds up a latent Blueprint node until a list of chunks are all in memory.
+class FPrefetchLatentAction : public FPendingLatentAction
+{
+public:
+	FPrefetchLatentAction(UPagedVolumeComponent* PrefetchVolume, const TArray<FIntVector>& PrefetchChunks, const FLatentActionInfo& LatentInfo)
+		: Volume(PrefetchVolume), Chunks(PrefetchChunks), ExecutionFunction(LatentInfo.ExecutionFunction), OutputLink(LatentInfo.Linkage), CallbackTarget(LatentInfo.CallbackTarget)
+	{
+	}
+
+	virtual void UpdateOperation(FLatentResponse& Response) override
+	{
+		UPagedVolumeComponent* volume = Volume.Get();
+		if (volume == NULL)
+		{
+			Response.FinishAndTriggerIf(true, ExecutionFunction, OutputLink, CallbackTarget);
+			return;
+		}
+		for (int32 i = Chunks.Num() - 1; i >= 0; i--)
+		{
+			if (volume->IsChunkResident(Chunks[i]))
+			{
+				Chunks.RemoveAtSwap(i, 1, false);
+			}
+			else
+			{
+				// It may have been evicted again before we saw it; this does nothing if it's still on its way.
+				volume->RequestChunk(Chunks[i]);
+			}
+		}
+		Response.FinishAndTriggerIf(Chunks.Num() == 0, ExecutionFunction, OutputLink, CallbackTarget);
+	}
+
+private:
+	TWeakObjectPtr<UPagedVolumeComponent> Volume;
+	TArray<FIntVector> Chunks;
+	FName ExecutionFunction;
+	int32 OutputLink;
+	FWeakObjectPtr CallbackTarget;
+};
+
 
 // Sets default values for this component's properties
 UPagedVolumeComponent::UPagedVolumeComponent()
@@ -42,14 +150,30 @@ UPagedVolumeComponent::UPagedVolumeComponent()
 	// off to improve performance if you don't need them.
 	PrimaryComponentTick.bCanEverTick = true;
 
-	ArrayChunks.SetNumZeroed(CHUNK_ARRAY_SIZE);
 	VolumePager = UPager::StaticClass();
 	ChunkSideLength = 32;
 }
 
 UPagedVolumeComponent::~UPagedVolumeComponent()
 {
-	//FlushAll();
+	// Actors are the world's problem by now, but the chunk data is ours to free.
+	CancelPageIns();
+	// EndPlay has normally saved everything by now; the pager may already be gone, so anything left can't be saved.
+	while (PageOutWritersInFlight.GetValue() > 0)
+	{
+		FPlatformProcess::Sleep(0.0f);
+	}
+	for (auto& pendingPageOut : PendingPageOuts)
+	{
+		delete pendingPageOut.Value;
+	}
+	PendingPageOuts.Empty();
+	GameThreadAccessor.Reset();
+	for (int32 i = 0; i < ChunkTable.GetCapacity(); i++)
+	{
+		delete ChunkTable.GetAtSlot(i);
+	}
+	ChunkTable.Empty();
 }
 
 
@@ -61,42 +185,672 @@ void UPagedVolumeComponent::BeginPlay()
 	InitializeVolume(VolumePager, TargetMemoryUsageInBytes, ChunkSideLength);
 }
 
+void UPagedVolumeComponent::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	FlushAll();
+
+	Super::EndPlay(EndPlayReason);
+}
+
 
 // Called every frame
 void UPagedVolumeComponent::TickComponent( float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction )
 {
 	Super::TickComponent( DeltaTime, TickType, ThisTickFunction );
 
-	if (ChunkCurrentlyMakingMeshFor != NULL)
+	CurrentTick++;
+	PublishPagedInChunks();
+	CompressColdChunks();
+	if (CurrentTick % EVICTION_INTERVAL_TICKS == 0)
+	{
+		EvictChunks();
+	}
+
+	// Chunks which were waiting on the pager go back in the queue once everything they need has arrived
+	for (int32 i = ChunksAwaitingPageIn.Num() - 1; i >= 0; i--)
+	{
+		if (RequestMeshInputs(ChunksAwaitingPageIn[i]))
+		{
+			ChunksToCreateMesh.Enqueue(ChunksAwaitingPageIn[i]);
+			ChunksAwaitingPageIn.RemoveAtSwap(i, 1, false);
+		}
+	}
+
+	FIntVector chunkPos;
+	while (ChunksToCreateMesh.Dequeue(chunkPos))
+	{
+		if (bPageInAsynchronously && !RequestMeshInputs(chunkPos))
+		{
+			// Meshing now would page the missing chunks in on the game thread
+			ChunksAwaitingPageIn.AddUnique(chunkPos);
+			continue;
+		}
+		CreateChunkMesh(GetChunk(chunkPos.X, chunkPos.Y, chunkPos.Z));
+		break;
+	}
+	// Everything the meshes above asked for goes to the workers together
+	StartPageIns();
+}
+
+bool UPagedVolumeComponent::RequestMeshInputs(const FIntVector& ChunkPos)
+{
+	// The mesh for a chunk reads one layer of voxels into its positive neighbours
+	bool bAllResident = true;
+	for (int32 z = 0; z <= 1; z++)
 	{
-		// We are working on making a chunk
-		if (!ChunkCurrentlyMakingMeshFor->bNeedsNewMarchingCubesMesh)
+		for (int32 y = 0; y <= 1; y++)
 		{
-			// Chunk is done being created; we don't need to work on the chunk anymore
-			ChunkCurrentlyMakingMeshFor = NULL;
+			for (int32 x = 0; x <= 1; x++)
+			{
+				const FIntVector position(ChunkPos.X + x, ChunkPos.Y + y, ChunkPos.Z + z);
+				if (!IsChunkResident(position))
+				{
+					if (!QueuePageIn(position, FOnChunkPagedIn()))
+					{
+						GetChunk(position.X, position.Y, position.Z);
+					}
+					bAllResident = false;
+				}
+			}
+		}
+	}
+	return bAllResident;
+}
+
+bool UPagedVolumeComponent::IsChunkResident(const FIntVector& ChunkPosition) const
+{
+	return FindChunk(ChunkPosition.X, ChunkPosition.Y, ChunkPosition.Z) != NULL;
+}
+
+void UPagedVolumeComponent::RequestChunk(const FIntVector& ChunkPosition, FOnChunkPagedIn OnPagedIn /*= FOnChunkPagedIn()*/)
+{
+	if (!QueuePageIn(ChunkPosition, OnPagedIn))
+	{
+		GetChunk(ChunkPosition.X, ChunkPosition.Y, ChunkPosition.Z);
+		OnPagedIn.ExecuteIfBound(ChunkPosition);
+		return;
+	}
+	StartPageIns();
+}
+
+bool UPagedVolumeComponent::QueuePageIn(const FIntVector& ChunkPosition, FOnChunkPagedIn OnPagedIn)
+{
+	// A chunk which is still waiting to be saved is just taken back off the queue, which is as quick as finding it.
+	if (IsChunkResident(ChunkPosition) || IsPageOutQueued(ChunkPosition))
+	{
+		return false;
+	}
+
+	FPendingPageIn* pending = PendingPageIns.Find(ChunkPosition);
+	if (pending == NULL)
+	{
+		pending = &PendingPageIns.Add(ChunkPosition);
+		ChunksToPageIn.Add(ChunkPosition);
+	}
+	// Otherwise it's already on its way
+	if (OnPagedIn.IsBound())
+	{
+		pending->Callbacks.Add(OnPagedIn);
+	}
+	return true;
+}
+
+void UPagedVolumeComponent::StartPageIns()
+{
+	if (ChunksToPageIn.Num() == 0)
+	{
+		return;
+	}
+
+	// Chunks are handed out in batches so that the pager can share its setup between them. The batches are evened
+	// out, so that a few stragglers don't end up in a batch on their own.
+	const int32 batchCount = FMath::DivideAndRoundUp(ChunksToPageIn.Num(), PAGE_IN_BATCH_SIZE);
+	const int32 batchSize = FMath::DivideAndRoundUp(ChunksToPageIn.Num(), batchCount);
+	for (int32 first = 0; first < ChunksToPageIn.Num(); first += batchSize)
+	{
+		TArray<FIntVector> batch;
+		batch.Append(ChunksToPageIn.GetData() + first, FMath::Min(batchSize, ChunksToPageIn.Num() - first));
+		PageInsInFlight.Increment();
+		FAutoDeleteAsyncTask<FChunkPageInTask>* task = new FAutoDeleteAsyncTask<FChunkPageInTask>(this, batch);
+		if (bPageInAsynchronously)
+		{
+			task->StartBackgroundTask();
 		}
 		else
 		{
-			// Chunk is still being worked on; wait a frame
-			return;
+			task->StartSynchronousTask();
+		}
+	}
+	ChunksToPageIn.Empty();
+
+	if (!bPageInAsynchronously)
+	{
+		// Everything is done already, so whoever asked for these chunks doesn't need to wait for the next tick
+		PublishPagedInChunks();
+	}
+}
+
+void UPagedVolumeComponent::PublishPagedInChunks()
+{
+	FPagedChunkData* chunk = NULL;
+	while (PagedInChunks.Dequeue(chunk))
+	{
+		const FIntVector position = chunk->GetChunkSpacePosition();
+		FPendingPageIn* pending = PendingPageIns.Find(position);
+		if (pending != NULL && pending->bStale)
+		{
+			delete chunk;
+			if (!IsPageOutQueued(position))
+			{
+				pending->bStale = false;
+				ChunksToPageIn.Add(position);
+				continue;
+			}
+			// The newer copy hasn't been saved yet, so it can be taken straight back
+			GetChunk(position.X, position.Y, position.Z);
+		}
+		else
+		{
+			ChunkTableLock.WriteLock();
+			if (ChunkTable.Find(position.X, position.Y, position.Z) != NULL)
+			{
+				// Something touched one of its voxels while it was being paged in, so it was paged in there and then
+				delete chunk;
+			}
+			else
+			{
+				chunk->LastAccessTick = CurrentTick;
+				ChunkTable.Add(chunk);
+				MarkChunkUsed(chunk);
+				if (bPageInAsynchronously)
+				{
+					AsyncPageIns++;
+				}
+			}
+			ChunkTableLock.WriteUnlock();
 		}
+
+		FPendingPageIn finished;
+		if (PendingPageIns.RemoveAndCopyValue(position, finished))
+		{
+			for (int32 i = 0; i < finished.Callbacks.Num(); i++)
+			{
+				finished.Callbacks[i].ExecuteIfBound(position);
+			}
+		}
+	}
+}
+
+void UPagedVolumeComponent::CancelPageIns()
+{
+	while (PageInsInFlight.GetValue() > 0)
+	{
+		FPlatformProcess::Sleep(0.0f);
+	}
+	FPagedChunkData* chunk = NULL;
+	while (PagedInChunks.Dequeue(chunk))
+	{
+		delete chunk;
 	}
-	// At this point, we are no longer working on any chunk
-	if (ChunksToCreateMesh.IsEmpty())
+	ChunksToPageIn.Empty();
+	PendingPageIns.Empty();
+	ChunksAwaitingPageIn.Empty();
+}
+
+void UPagedVolumeComponent::QueuePageOut(FPagedChunkData* Chunk)
+{
+	const FIntVector& position = Chunk->GetChunkSpacePosition();
+	bool bStartWriter = false;
 	{
-		// We have no chunks to make
+		FScopeLock lock(&PageOutLock);
+		checkf(!PendingPageOuts.Contains(position), TEXT("Chunk (%d, %d, %d) was queued to be paged out twice"), position.X, position.Y, position.Z);
+		PendingPageOuts.Add(position, Chunk);
+		PageOutGeneration++;
+		if (!bPageOutWriterRunning)
+		{
+			bPageOutWriterRunning = true;
+			PageOutWritersInFlight.Increment();
+			bStartWriter = true;
+		}
+	}
+	if (bStartWriter)
+	{
+		(new FAutoDeleteAsyncTask<FChunkPageOutTask>(this))->StartBackgroundTask();
+	}
+}
+
+void UPagedVolumeComponent::WritePendingPageOuts()
+{
+	while (true)
+	{
+		FPagedChunkData* chunk = NULL;
+		FIntVector position;
+		{
+			FScopeLock lock(&PageOutLock);
+			if (PendingPageOuts.Num() == 0)
+			{
+				bPageOutWriterRunning = false;
+				return;
+			}
+			TMap<FIntVector, FPagedChunkData*>::TIterator pendingPageOut = PendingPageOuts.CreateIterator();
+			chunk = pendingPageOut.Value();
+			position = pendingPageOut.Key();
+			ChunksBeingPagedOut.Add(position);
+			pendingPageOut.RemoveCurrent();
+		}
+
+		// Nothing else can see the chunk now, so it can be saved without holding anything up
+		PageOutChunk(chunk, true);
+		FinishPageOut(position);
+	}
+}
+
+bool UPagedVolumeComponent::IsPageOutQueued(const FIntVector& ChunkPosition) const
+{
+	FScopeLock lock(&PageOutLock);
+	return PendingPageOuts.Contains(ChunkPosition);
+}
+
+void UPagedVolumeComponent::WaitForPageOut(const FIntVector& ChunkPosition) const
+{
+	while (true)
+	{
+		{
+			FScopeLock lock(&PageOutLock);
+			if (!ChunksBeingPagedOut.Contains(ChunkPosition))
+			{
+				return;
+			}
+		}
+		FPlatformProcess::Sleep(0.0f);
+	}
+}
+
+void UPagedVolumeComponent::FinishPageOut(const FIntVector& ChunkPosition)
+{
+	FScopeLock lock(&PageOutLock);
+	ChunksBeingPagedOut.Remove(ChunkPosition);
+}
+
+FPagedChunkData* UPagedVolumeComponent::ReclaimPageOut(const FIntVector& ChunkPosition)
+{
+	FPagedChunkData* chunk = NULL;
+	{
+		FScopeLock lock(&PageOutLock);
+		if (!PendingPageOuts.RemoveAndCopyValue(ChunkPosition, chunk))
+		{
+			return NULL;
+		}
+	}
+
+	// Its mesh actor went when it was evicted, so it needs meshing from scratch
+	chunk->MarkAllDirty();
+	ChunkTable.Add(chunk);
+	PageOutsReclaimed++;
+	return chunk;
+}
+
+void UPagedVolumeComponent::FlushPageOuts()
+{
+	while (PageOutWritersInFlight.GetValue() > 0)
+	{
+		FPlatformProcess::Sleep(0.001f);
+	}
+}
+
+void UPagedVolumeComponent::CreateChunkMesh(FPagedChunkData* Chunk)
+{
+	FIntVector dirtyLower;
+	FIntVector dirtyUpper;
+	if (Chunk == NULL || !Chunk->GetDirtyRegion(dirtyLower, dirtyUpper))
+	{
+		// Nothing has changed since the last mesh
 		return;
 	}
+	Chunk->bWantsMesh = true;
+
+	const uint8 blockPower = GetMeshBlockSideLengthPower();
+	const int32 blockSideLength = 1 << blockPower;
+	const int32 blocksPerSide = ChunkSideLength >> blockPower;
+	APagedChunk* meshActor = Chunk->GetMeshActor();
+	// With asynchronous paging, Tick only gets here once RequestMeshInputs() has found everything the mesh reads in
+	// memory, so the extractor must not page anything in behind its back
+	const ESamplerBorderPolicy borderPolicy = bPageInAsynchronously ? ESamplerBorderPolicy::Clamp : ESamplerBorderPolicy::PageIn;
+
+	FIntVector lowerBlock(0, 0, 0);
+	FIntVector upperBlock(blocksPerSide - 1, blocksPerSide - 1, blocksPerSide - 1);
+	TArray<TArray<FVoxelMeshSection>> newBlocks;
+	TArray<TArray<FVoxelMeshSection>>* blocks = &newBlocks;
+	if (meshActor != NULL && meshActor->MeshBlocks.Num() == blocksPerSide * blocksPerSide * blocksPerSide)
+	{
+		// Each cell belongs to the block holding its lower corner. A changed voxel is the upper corner of the cells
+		// below it as well, so those need extracting too; the voxels past the end of the chunk only touch our last cells.
+		lowerBlock.X = FMath::Max(dirtyLower.X - 1, 0) >> blockPower;
+		lowerBlock.Y = FMath::Max(dirtyLower.Y - 1, 0) >> blockPower;
+		lowerBlock.Z = FMath::Max(dirtyLower.Z - 1, 0) >> blockPower;
+		upperBlock.X = FMath::Min(dirtyUpper.X, (int32)ChunkSideLength - 1) >> blockPower;
+		upperBlock.Y = FMath::Min(dirtyUpper.Y, (int32)ChunkSideLength - 1) >> blockPower;
+		upperBlock.Z = FMath::Min(dirtyUpper.Z, (int32)ChunkSideLength - 1) >> blockPower;
+		blocks = &meshActor->MeshBlocks;
+	}
 	else
 	{
-		ChunksToCreateMesh.Dequeue(ChunkCurrentlyMakingMeshFor);
-		if (ChunkCurrentlyMakingMeshFor != NULL)
+		newBlocks.SetNum(blocksPerSide * blocksPerSide * blocksPerSide);
+	}
+
+	bool bHasTriangles = false;
+	for (int32 z = lowerBlock.Z; z <= upperBlock.Z; z++)
+	{
+		for (int32 y = lowerBlock.Y; y <= upperBlock.Y; y++)
+		{
+			for (int32 x = lowerBlock.X; x <= upperBlock.X; x++)
+			{
+				const int32 lowerX = Chunk->ChunkRegion.LowerX + (x << blockPower);
+				const int32 lowerY = Chunk->ChunkRegion.LowerY + (y << blockPower);
+				const int32 lowerZ = Chunk->ChunkRegion.LowerZ + (z << blockPower);
+				const FRegion blockRegion = URegionHelper::CreateRegionFromInt(lowerX, lowerY, lowerZ, lowerX + blockSideLength, lowerY + blockSideLength, lowerZ + blockSideLength);
+
+				TArray<FVoxelMeshSection>& blockSections = (*blocks)[x + y * blocksPerSide + z * blocksPerSide * blocksPerSide];
+				blockSections = UVoxelProceduralMeshComponent::ExtractMarchingCubesMesh(this, blockRegion, borderPolicy);
+				bHasTriangles |= blockSections.Num() > 0;
+			}
+		}
+	}
+
+	if (meshActor == NULL && bHasTriangles)
+	{
+		meshActor = GetWorld()->SpawnActor<APagedChunk>();
+		meshActor->InitChunk(Chunk->ChunkRegion, VoxelSize);
+		Chunk->MeshActor = meshActor;
+	}
+	if (meshActor != NULL)
+	{
+		if (blocks == &newBlocks)
+		{
+			meshActor->MeshBlocks = MoveTemp(newBlocks);
+		}
+		meshActor->UpdateMeshFromBlocks(ChunkMaterials);
+		meshActor->MeshEditVersion = Chunk->GetEditVersion();
+	}
+	Chunk->ClearDirtyRegion();
+}
+
+void UPagedVolumeComponent::QueueChunkMesh(FPagedChunkData* Chunk)
+{
+	if (Chunk->bWantsMesh)
+	{
+		ChunksToCreateMesh.Enqueue(Chunk->GetChunkSpacePosition());
+	}
+}
+
+void UPagedVolumeComponent::CompressColdChunks()
+{
+	if (TicksBeforeCompression <= 0 || ChunkTable.Num() == 0)
+	{
+		return;
+	}
+
+	ChunkTableLock.WriteLock();
+
+	// Only look at a slice of the table each tick so that the sweep doesn't cause a hitch. The whole table gets
+	// covered every 64 ticks, which is far quicker than any sensible compression delay.
+	const uint32 capacity = (uint32)ChunkTable.GetCapacity();
+	const uint32 slotsPerTick = FMath::Max(capacity / 64, 1u);
+	for (uint32 i = 0; i < slotsPerTick; i++)
+	{
+		CompressionSweepIndex %= capacity;
+		FPagedChunkData* chunk = ChunkTable.GetAtSlot(CompressionSweepIndex);
+		CompressionSweepIndex++;
+
+		// Uniform chunks are already as small as they are going to get, and pinned chunks are being read
+		// directly by an accessor, so they must stay uncompressed.
+		if (chunk == NULL || chunk->IsCompressed() || chunk->IsUniform() || chunk->PinCount.GetValue() > 0)
+		{
+			continue;
+		}
+		if (CurrentTick - chunk->LastAccessTick >= (uint32)TicksBeforeCompression)
+		{
+			if (chunk->Compress())
+			{
+				ChunkCompressions++;
+			}
+			else
+			{
+				// Not worth compressing right now; don't try again until it has been cold for another full period.
+				chunk->LastAccessTick = CurrentTick;
+			}
+		}
+	}
+	ChunkTableLock.WriteUnlock();
+}
+
+void UPagedVolumeComponent::EvictChunks()
+{
+	const int64 budget = TargetMemoryUsageInBytes;
+
+	// Victims are unlinked under the lock. Without the background writer they are paged out after it is released, so
+	// that other threads aren't held up while the pager saves them. Modified ones are marked as being paged out first,
+	// so that nobody loads the older copy the pager still has in the meantime.
+	TArray<FPagedChunkData*> victims;
+	ChunkTableLock.WriteLock();
+	int64 residentBytes = GetResidentBytes();
+	{
+		FScopeLock lock(&RecentlyUsedLock);
+		FPagedChunkData* chunk = LeastRecentlyUsedChunk;
+		while (residentBytes > budget && chunk != NULL && ChunkTable.Num() > MIN_RESIDENT_CHUNKS)
+		{
+			FPagedChunkData* next = chunk->MoreRecentlyUsed;
+			// Pinned chunks are still being read by an accessor, so they have to stay.
+			if (chunk->PinCount.GetValue() == 0)
+			{
+				residentBytes -= chunk->GetDataSizeInBytes();
+				if (chunk->IsModified())
+				{
+					ChunkPageOuts++;
+				}
+				ChunkEvictions++;
+
+				const FIntVector& chunkPos = chunk->GetChunkSpacePosition();
+				ChunkTable.Remove(chunkPos.X, chunkPos.Y, chunkPos.Z);
+				RemoveFromRecentlyUsed(chunk);
+				victims.Add(chunk);
+			}
+			chunk = next;
+		}
+	}
+	if (bPageOutAsynchronously)
+	{
+		// Nothing here waits on the pager, so modified victims can go straight onto the writer's queue. That way there
+		// is never a moment where another thread could find one in neither the table nor the queue. The rest are no
+		// different to what the pager would give back, but compressing them for the cache is left until after.
+		for (int32 i = victims.Num() - 1; i >= 0; i--)
+		{
+			if (victims[i]->IsModified())
+			{
+				DeleteChunk(victims[i]);
+				victims.RemoveAtSwap(i, 1, false);
+			}
+		}
+	}
+	else
+	{
+		FScopeLock lock(&PageOutLock);
+		for (int32 i = 0; i < victims.Num(); i++)
+		{
+			if (victims[i]->IsModified())
+			{
+				ChunksBeingPagedOut.Add(victims[i]->GetChunkSpacePosition());
+			}
+		}
+		// Anyone who was already loading one of these from the pager will see this and start again
+		PageOutGeneration++;
+	}
+	ChunkTableLock.WriteUnlock();
+
+	for (int32 i = 0; i < victims.Num(); i++)
+	{
+		const FIntVector position = victims[i]->GetChunkSpacePosition();
+		const bool bIsModified = victims[i]->IsModified();
+		DeleteChunk(victims[i]);
+		if (bIsModified)
+		{
+			FinishPageOut(position);
+		}
+	}
+}
+
+int64 UPagedVolumeComponent::GetResidentBytes() const
+{
+	int64 sizeInBytes = 0;
+	for (int32 i = 0; i < ChunkTable.GetCapacity(); i++)
+	{
+		const FPagedChunkData* chunk = ChunkTable.GetAtSlot(i);
+		if (chunk != NULL)
+		{
+			sizeInBytes += chunk->GetDataSizeInBytes();
+		}
+	}
+	return sizeInBytes;
+}
+
+void UPagedVolumeComponent::MarkChunkUsed(FPagedChunkData* Chunk)
+{
+	FScopeLock lock(&RecentlyUsedLock);
+	if (Chunk == MostRecentlyUsedChunk)
+	{
+		return;
+	}
+	RemoveFromRecentlyUsed(Chunk);
+
+	Chunk->LessRecentlyUsed = MostRecentlyUsedChunk;
+	if (MostRecentlyUsedChunk != NULL)
+	{
+		MostRecentlyUsedChunk->MoreRecentlyUsed = Chunk;
+	}
+	MostRecentlyUsedChunk = Chunk;
+	if (LeastRecentlyUsedChunk == NULL)
+	{
+		LeastRecentlyUsedChunk = Chunk;
+	}
+}
+
+void UPagedVolumeComponent::RemoveFromRecentlyUsed(FPagedChunkData* Chunk)
+{
+	if (Chunk->LessRecentlyUsed != NULL)
+	{
+		Chunk->LessRecentlyUsed->MoreRecentlyUsed = Chunk->MoreRecentlyUsed;
+	}
+	else if (LeastRecentlyUsedChunk == Chunk)
+	{
+		LeastRecentlyUsedChunk = Chunk->MoreRecentlyUsed;
+	}
+	if (Chunk->MoreRecentlyUsed != NULL)
+	{
+		Chunk->MoreRecentlyUsed->LessRecentlyUsed = Chunk->LessRecentlyUsed;
+	}
+	else if (MostRecentlyUsedChunk == Chunk)
+	{
+		MostRecentlyUsedChunk = Chunk->LessRecentlyUsed;
+	}
+	Chunk->LessRecentlyUsed = NULL;
+	Chunk->MoreRecentlyUsed = NULL;
+}
+
+void UPagedVolumeComponent::DeleteChunk(FPagedChunkData* Chunk, bool bKeepCompressedCopy /*= true*/)
+{
+	if (Chunk == NULL)
+	{
+		return;
+	}
+	checkf(Chunk->PinCount.GetValue() == 0, TEXT("Deleting a chunk which is still pinned by an accessor"));
+	FPendingPageIn* pending = PendingPageIns.Find(Chunk->GetChunkSpacePosition());
+	if (pending != NULL)
+	{
+		// A worker is already paging this position in again, from data older than what we're about to save
+		pending->bStale = true;
+	}
+	{
+		FScopeLock lock(&RecentlyUsedLock);
+		RemoveFromRecentlyUsed(Chunk);
+	}
+
+	APagedChunk* meshActor = Chunk->GetMeshActor();
+	if (meshActor != NULL)
+	{
+		meshActor->Destroy();
+	}
+	Chunk->MeshActor.Reset();
+
+	if (bPageOutAsynchronously && Chunk->IsModified())
+	{
+		QueuePageOut(Chunk);
+		return;
+	}
+	PageOutChunk(Chunk, bKeepCompressedCopy);
+}
+
+void UPagedVolumeComponent::LoadChunk(FPagedChunkData* Chunk, const FIntVector& ChunkPosition)
+{
+	TArray<uint8> cachedVoxels;
+	const bool bIsCached = CompressedChunkCache.Take(ChunkPosition, cachedVoxels);
+	Chunk->InitChunk(ChunkPosition, ChunkSideLength, Pager, RandomSeed, &ChunkBufferPool, bIsCached ? &cachedVoxels : nullptr);
+}
+
+void UPagedVolumeComponent::LoadChunks(const TArray<FIntVector>& ChunkPositions, TArray<FPagedChunkData*>& OutChunks)
+{
+	// Cached chunks are filled in from the cache as we go; everything else goes to the pager in one batch.
+	TArray<FPagedChunkData*> chunksToPageIn;
+	TArray<uint8> cachedVoxels;
+	OutChunks.Reserve(OutChunks.Num() + ChunkPositions.Num());
+	for (int32 i = 0; i < ChunkPositions.Num(); i++)
+	{
+		FPagedChunkData* chunk = new FPagedChunkData();
+		OutChunks.Add(chunk);
+		if (CompressedChunkCache.Take(ChunkPositions[i], cachedVoxels))
+		{
+			chunk->InitChunk(ChunkPositions[i], ChunkSideLength, Pager, RandomSeed, &ChunkBufferPool, &cachedVoxels);
+		}
+		else if (chunk->PrepareForPageIn(ChunkPositions[i], ChunkSideLength, Pager, RandomSeed, &ChunkBufferPool))
 		{
-			ChunkCurrentlyMakingMeshFor->CreateMarchingCubesMesh(this, ChunkMaterials);
+			chunksToPageIn.Add(chunk);
 		}
 	}
+
+	if (chunksToPageIn.Num() > 0)
+	{
+		Pager->PageInBatch(chunksToPageIn);
+	}
+	for (int32 i = 0; i < chunksToPageIn.Num(); i++)
+	{
+		chunksToPageIn[i]->FinishPageIn();
+	}
 }
 
+void UPagedVolumeComponent::PageOutChunk(FPagedChunkData* Chunk, bool bKeepCompressedCopy)
+{
+	const FIntVector position = Chunk->GetChunkSpacePosition();
+	const int64 cacheBudget = CompressedCacheSizeInBytes;
+	TArray<uint8> voxels;
+	if (bKeepCompressedCopy && cacheBudget > 0)
+	{
+		Chunk->SerializeVoxels(voxels);
+	}
+	Chunk->RemoveChunk();
+	delete Chunk;
+
+	// This only happens once the pager has finished with the chunk. Anyone who takes it out of the cache and then has
+	// to throw it away (because it was paged in again elsewhere) will find the same voxels in the pager.
+	CompressedChunkCache.SetBudget(cacheBudget);
+	if (bKeepCompressedCopy && cacheBudget > 0)
+	{
+		CompressedChunkCache.Add(position, voxels);
+	}
+	else
+	{
+		// Anything already cached is older than what was just paged out
+		CompressedChunkCache.Remove(position);
+	}
+}
 
 void UPagedVolumeComponent::InitializeVolume(TSubclassOf<UPager> PagerClass, int32 MemoryUsageInBytes /*= 256 * 1024 * 1024*/, uint8 VolumeChunkSideLength /*= 32*/)
 {
@@ -121,11 +875,6 @@ void UPagedVolumeComponent::InitializeVolume(TSubclassOf<UPager> PagerClass, int
 		return;
 	}
 
-	if (ArrayChunks.Num() == 0)
-	{
-		ArrayChunks.SetNumZeroed(CHUNK_ARRAY_SIZE);
-	}
-
 	ChunkSideLength = VolumeChunkSideLength;
 	// Used to perform multiplications and divisions by bit shifting.
 	ChunkSideLengthPower = (uint8)FMath::Log2(ChunkSideLength);
@@ -133,21 +882,26 @@ void UPagedVolumeComponent::InitializeVolume(TSubclassOf<UPager> PagerClass, int
 	ChunkMask = ChunkSideLength - 1;
 
 	// Calculate the number of chunks based on the memory limit and the size of each chunk.
-	int32 ChunkSizeInBytes = APagedChunk::CalculateSizeInBytes(ChunkSideLength);
+	// This is only an estimate; eviction goes by the actual size of each chunk.
+	TargetMemoryUsageInBytes = MemoryUsageInBytes;
+	int32 ChunkSizeInBytes = FPagedChunkData::CalculateSizeInBytes(ChunkSideLength);
 	ChunkCountLimit = MemoryUsageInBytes / ChunkSizeInBytes;
 
-	// Enforce sensible limits on the number of chunks.
-	const int32 MinPracticalNoOfChunks = 32; // Enough to make sure a chunks and it's neighbors can be loaded, with a few to spare.
-	const int32 MaxPracticalNoOfChunks = CHUNK_ARRAY_SIZE / 2; // A hash table should only become half-full to avoid too many clashes.
-	if (ChunkCountLimit < MinPracticalNoOfChunks)
+	// Enforce sensible limits on the number of chunks. There's no upper limit as the chunk table grows to fit.
+	if (ChunkCountLimit < MIN_RESIDENT_CHUNKS)
 	{
 		UE_LOG(LogPolyVox, Warning, TEXT("Requested memory usage limit of %d MB is too low and cannot be adhered to."), (MemoryUsageInBytes / (1024 * 1024)));
 	}
-	ChunkCountLimit = FMath::Max(ChunkCountLimit, MinPracticalNoOfChunks);
-	ChunkCountLimit = FMath::Min(ChunkCountLimit, MaxPracticalNoOfChunks);
+	ChunkCountLimit = FMath::Max(ChunkCountLimit, MIN_RESIDENT_CHUNKS);
 	
 	VolumePager = PagerClass;
 	Pager = NewObject<UPager>((UObject*)GetTransientPackage(), PagerClass, NAME_None);
+	if (Pager->IsImplementedInBlueprint() && (bPageInAsynchronously || bPageOutAsynchronously))
+	{
+		UE_LOG(LogPolyVox, Log, TEXT("%s is a Blueprint pager, so chunks will be paged in and out on the game thread."), *Pager->GetClass()->GetName());
+		bPageInAsynchronously = false;
+		bPageOutAsynchronously = false;
+	}
 
 	// Inform the user about the chosen memory configuration.
 	UE_LOG(LogPolyVox, Log, TEXT("Memory usage limit for volume now set to %d MB (%d chunks of %d KB each)."), ((ChunkCountLimit * ChunkSizeInBytes) / (1024 * 1024)), ChunkCountLimit, (ChunkSizeInBytes / 1024));
@@ -163,29 +917,130 @@ FVoxel UPagedVolumeComponent::GetVoxelByCoordinates(int32 XPos, int32 YPos, int3
 	const uint16 yOffset = (uint16)(YPos & ChunkMask);
 	const uint16 zOffset = (uint16)(ZPos & ChunkMask);
 
-	auto pChunk = CanReuseLastAccessedChunk(chunkX, chunkY, chunkZ) ? LastAccessedChunk : GetChunk(chunkX, chunkY, chunkZ);
+	auto pChunk = GetGameThreadAccessor().GetChunk(chunkX, chunkY, chunkZ);
 
 	return pChunk->GetVoxelByCoordinatesChunkSpace(xOffset, yOffset, zOffset);
 }
 
-FVoxel UPagedVolumeComponent::GetVoxelByVector(const FVector& Coordinates)
+FVoxel UPagedVolumeComponent::GetVoxelByVector(const FVector& Coordinates)
+{
+	return GetVoxelByCoordinates((int32)Coordinates.X, (int32)Coordinates.Y, (int32)Coordinates.Z);
+}
+
+void UPagedVolumeComponent::SetVoxelByCoordinates(int32 XPos, int32 YPos, int32 ZPos, FVoxel Voxel)
+{
+	const int32 chunkX = XPos >> ChunkSideLengthPower;
+	const int32 chunkY = YPos >> ChunkSideLengthPower;
+	const int32 chunkZ = ZPos >> ChunkSideLengthPower;
+
+	const uint16 xOffset = (uint16)(XPos & ChunkMask);
+	const uint16 yOffset = (uint16)(YPos & ChunkMask);
+	const uint16 zOffset = (uint16)(ZPos & ChunkMask);
+
+	auto pChunk = GetGameThreadAccessor().GetChunk(chunkX, chunkY, chunkZ);
+
+	SetVoxelInChunk(pChunk, FIntVector(chunkX, chunkY, chunkZ), FIntVector(xOffset, yOffset, zOffset), Voxel);
+}
+
+void UPagedVolumeComponent::SetVoxelInChunk(FPagedChunkData* Chunk, const FIntVector& ChunkPos, const FIntVector& Offset, FVoxel Voxel)
+{
+	bool bBecameDirty = false;
+	if (!Chunk->SetVoxel(Offset.X, Offset.Y, Offset.Z, Voxel, bBecameDirty))
+	{
+		// The voxel already had this value
+		return;
+	}
+	if (bBecameDirty)
+	{
+		QueueChunkMesh(Chunk);
+	}
+	MarkNeighboursDirty(ChunkPos, Offset, Offset);
+}
+
+void UPagedVolumeComponent::MarkNeighboursDirty(const FIntVector& ChunkPos, const FIntVector& Lower, const FIntVector& Upper)
+{
+	// The mesh for a chunk reads one layer of voxels into its positive neighbours, so voxels on the lower faces of
+	// this chunk are also part of the meshes of up to 7 neighbours, where they sit at SideLength on that axis.
+	if (Lower.X != 0 && Lower.Y != 0 && Lower.Z != 0)
+	{
+		return;
+	}
+
+	// Neighbours aren't pinned, so hold the table lock to stop them being evicted while they're marked.
+	ChunkTableLock.ReadLock();
+	for (int32 z = (Lower.Z == 0 ? -1 : 0); z <= 0; z++)
+	{
+		for (int32 y = (Lower.Y == 0 ? -1 : 0); y <= 0; y++)
+		{
+			for (int32 x = (Lower.X == 0 ? -1 : 0); x <= 0; x++)
+			{
+				if (x == 0 && y == 0 && z == 0)
+				{
+					continue;
+				}
+
+				// Neighbours which aren't resident will get a complete mesh when they are paged in
+				FPagedChunkData* neighbour = ChunkTable.Find(ChunkPos.X + x, ChunkPos.Y + y, ChunkPos.Z + z);
+				if (neighbour == NULL)
+				{
+					continue;
+				}
+				const FIntVector neighbourLower(x < 0 ? ChunkSideLength : Lower.X, y < 0 ? ChunkSideLength : Lower.Y, z < 0 ? ChunkSideLength : Lower.Z);
+				const FIntVector neighbourUpper(x < 0 ? ChunkSideLength : Upper.X, y < 0 ? ChunkSideLength : Upper.Y, z < 0 ? ChunkSideLength : Upper.Z);
+				if (neighbour->MarkDirty(neighbourLower, neighbourUpper))
+				{
+					QueueChunkMesh(neighbour);
+				}
+			}
+		}
+	}
+	ChunkTableLock.ReadUnlock();
+}
+
+void UPagedVolumeComponent::VisitRegion(const FRegion& Region, TFunctionRef<void(FChunkRegionView&)> Visitor, bool bTopDown /*= false*/)
 {
-	return GetVoxelByCoordinates((int32)Coordinates.X, (int32)Coordinates.Y, (int32)Coordinates.Z);
-}
+	if (Region.UpperX <= Region.LowerX || Region.UpperY <= Region.LowerY || Region.UpperZ <= Region.LowerZ)
+	{
+		return;
+	}
 
-void UPagedVolumeComponent::SetVoxelByCoordinates(int32 XPos, int32 YPos, int32 ZPos, FVoxel Voxel)
-{
-	const int32 chunkX = XPos >> ChunkSideLengthPower;
-	const int32 chunkY = YPos >> ChunkSideLengthPower;
-	const int32 chunkZ = ZPos >> ChunkSideLengthPower;
+	const int32 lowerChunkX = Region.LowerX >> ChunkSideLengthPower;
+	const int32 lowerChunkY = Region.LowerY >> ChunkSideLengthPower;
+	const int32 lowerChunkZ = Region.LowerZ >> ChunkSideLengthPower;
+	const int32 upperChunkX = (Region.UpperX - 1) >> ChunkSideLengthPower;
+	const int32 upperChunkY = (Region.UpperY - 1) >> ChunkSideLengthPower;
+	const int32 upperChunkZ = (Region.UpperZ - 1) >> ChunkSideLengthPower;
 
-	const uint16 xOffset = (uint16)(XPos & ChunkMask);
-	const uint16 yOffset = (uint16)(YPos & ChunkMask);
-	const uint16 zOffset = (uint16)(ZPos & ChunkMask);
+	for (int32 i = 0; i <= upperChunkZ - lowerChunkZ; i++)
+	{
+		const int32 chunkZ = bTopDown ? upperChunkZ - i : lowerChunkZ + i;
+		for (int32 chunkY = lowerChunkY; chunkY <= upperChunkY; chunkY++)
+		{
+			for (int32 chunkX = lowerChunkX; chunkX <= upperChunkX; chunkX++)
+			{
+				const FIntVector chunkPos(chunkX, chunkY, chunkZ);
+				const FIntVector origin(chunkX << ChunkSideLengthPower, chunkY << ChunkSideLengthPower, chunkZ << ChunkSideLengthPower);
+				const FIntVector lower(FMath::Max(Region.LowerX - origin.X, 0), FMath::Max(Region.LowerY - origin.Y, 0), FMath::Max(Region.LowerZ - origin.Z, 0));
+				const FIntVector upper(FMath::Min(Region.UpperX - 1 - origin.X, ChunkMask), FMath::Min(Region.UpperY - 1 - origin.Y, ChunkMask), FMath::Min(Region.UpperZ - 1 - origin.Z, ChunkMask));
 
-	auto pChunk = CanReuseLastAccessedChunk(chunkX, chunkY, chunkZ) ? LastAccessedChunk : GetChunk(chunkX, chunkY, chunkZ);
+				FPagedChunkData* chunk = GetPinnedChunk(chunkX, chunkY, chunkZ);
+				FChunkRegionView view(chunk, origin, lower, upper);
+				Visitor(view);
 
-	pChunk->SetVoxelByCoordinatesChunkSpace(xOffset, yOffset, zOffset, Voxel);
+				// Everything written through the view is marked dirty in one go
+				if (view.WasModified())
+				{
+					chunk->FinishBulkWrite();
+					if (chunk->MarkDirty(view.GetModifiedLower(), view.GetModifiedUpper()))
+					{
+						QueueChunkMesh(chunk);
+					}
+					MarkNeighboursDirty(chunkPos, view.GetModifiedLower(), view.GetModifiedUpper());
+				}
+				UnpinChunk(chunk);
+			}
+		}
+	}
 }
 
 void UPagedVolumeComponent::SetVoxelByVector(const FVector& Coordinates, FVoxel Voxel)
@@ -218,7 +1073,7 @@ void UPagedVolumeComponent::PageInChunksAroundPlayer(AController* PlayerControll
 	}
 }
 
-TArray<APagedChunk*> UPagedVolumeComponent::Prefetch(FRegion PrefetchRegion)
+TArray<FIntVector> UPagedVolumeComponent::Prefetch(FRegion PrefetchRegion)
 {
 	// Convert the start and end positions into chunk space coordinates
 	FVector lowerCorner = URegionHelper::GetLowerCorner(PrefetchRegion);
@@ -245,84 +1100,236 @@ TArray<APagedChunk*> UPagedVolumeComponent::Prefetch(FRegion PrefetchRegion)
 	UE_LOG(LogPolyVox, Log, TEXT("Fetching chunks from (%f, %f, %f) to (%f, %f, %f)."), start.X, start.Y, start.Z, end.X, end.Y, end.Z);
 
 	// Loops over the specified positions and touch the corresponding chunks.
-	TArray<APagedChunk*> touchedChunks;
+	TArray<FIntVector> touchedChunks;
 	for (int32 x = start.X; x <= end.X; x++)
 	{
 		for (int32 y = start.Y; y <= end.Y; y++)
 		{
 			for (int32 z = start.Z; z <= end.Z; z++)
 			{
-				touchedChunks.Add(GetChunk(x, y, z));
+				// Chunks which aren't here yet are paged in together, on the workers if that's allowed. The ones
+				// which are here just get touched.
+				if (!QueuePageIn(FIntVector(x, y, z), FOnChunkPagedIn()))
+				{
+					GetChunk(x, y, z);
+				}
+				touchedChunks.Add(FIntVector(x, y, z));
 			}
 		}
 	}
+	StartPageIns();
+
+	// As we have added chunks we may have gone over our memory budget. The chunks we just touched are the
+	// most recently used, so they'll be the last to go.
+	EvictChunks();
+	return touchedChunks;
+}
+
+void UPagedVolumeComponent::PrefetchAndWait(FRegion PrefetchRegion, FLatentActionInfo LatentInfo)
+{
+	TArray<FIntVector> chunks = Prefetch(PrefetchRegion);
+
+	UWorld* world = GetWorld();
+	if (world == NULL)
+	{
+		return;
+	}
+	FLatentActionManager& latentActionManager = world->GetLatentActionManager();
+	if (latentActionManager.FindExistingAction<FPrefetchLatentAction>(LatentInfo.CallbackTarget, LatentInfo.UUID) == NULL)
+	{
+		latentActionManager.AddNewAction(LatentInfo.CallbackTarget, LatentInfo.UUID, new FPrefetchLatentAction(this, chunks, LatentInfo));
+	}
+}
+
+void UPagedVolumeComponent::FlushAll()
+{
+	// The workers use the buffer pool and pager, so they have to finish before anything is torn down.
+	CancelPageIns();
 
-	// As we have added a chunk we may have exceeded our target chunk limit. Search through the array to
-	// determine how many chunks we have, as well as finding the oldest timestamp. Note that this is potentially
-	// wasteful and we may instead wish to track how many chunks we have and/or delete a chunk at random (or
-	// just check e.g. 10 and delete the oldest of those) but we'll see if this is a bottleneck first. Paging
-	// the data in is probably more expensive.
-	TArray<APagedChunk*> toPageOut;
-	uint32 chunkCount = 0;
-	for (uint32 uIndex = 0; uIndex < CHUNK_ARRAY_SIZE; uIndex++)
+	// Let go of the game thread's pin, as all chunks are about to be removed.
+	if (GameThreadAccessor.IsValid())
 	{
-		if (ArrayChunks[uIndex])
-		{
-			chunkCount++;
-			if (ArrayChunks[uIndex]->bDueToBePagedOut)
-			{
-				toPageOut.Add(ArrayChunks[uIndex]);
-			}
-		}
+		GameThreadAccessor->Reset();
 	}
 
-	// Check if we have too many chunks, and delete the oldest if so.
-	while (chunkCount > (uint32)ChunkCountLimit && toPageOut.Num() > 0)
+	// Erase all the most recently used chunks. There's no point caching them, as the cache is about to be emptied.
+	for (int32 i = 0; i < ChunkTable.GetCapacity(); i++)
 	{
-		toPageOut[0]->Destroy();
-		toPageOut.RemoveAt(0);
+		DeleteChunk(ChunkTable.GetAtSlot(i), false);
 	}
-	return touchedChunks;
+	ChunkTable.Empty();
+	// The writer gives buffers back to the pool and fills the cache as it goes, so it has to finish before they are emptied.
+	FlushPageOuts();
+	CompressedChunkCache.Empty();
+	ChunksToCreateMesh.Empty();
+	ChunkBufferPool.Empty();
+	MostRecentlyUsedChunk = NULL;
+	LeastRecentlyUsedChunk = NULL;
 }
 
-void UPagedVolumeComponent::FlushAll()
+int32 UPagedVolumeComponent::CalculateSizeInBytes() const
 {
-	// Clear this pointer as all chunks are about to be removed.
-	LastAccessedChunk = NULL;
+	// Note: We disregard the size of the other class members as they are likely to be very small compared to the size of the
+	// allocated voxel data.
+	return (int32)FMath::Min(GetResidentBytes(), (int64)MAX_int32);
+}
 
-	// Erase all the most recently used chunks.
-	for (uint32 uIndex = 0; uIndex < CHUNK_ARRAY_SIZE; uIndex++)
+FPagedVolumeStats UPagedVolumeComponent::GetVolumeStats() const
+{
+	FPagedVolumeStats stats;
+	for (int32 i = 0; i < ChunkTable.GetCapacity(); i++)
 	{
-		APagedChunk* chunk = ArrayChunks[uIndex];
-		if (chunk != NULL)
+		const FPagedChunkData* chunk = ChunkTable.GetAtSlot(i);
+		if (chunk == NULL)
 		{
-			chunk->RemoveChunk();
-			chunk->Destroy();
+			continue;
 		}
+		stats.ResidentChunks++;
+		if (chunk->IsCompressed())
+		{
+			stats.CompressedChunks++;
+			stats.CompressedBytes += chunk->GetDataSizeInBytes();
+		}
+		else
+		{
+			stats.UncompressedBytes += chunk->GetDataSizeInBytes();
+		}
+	}
+	stats.ChunkCompressions = ChunkCompressions;
+	stats.ChunkDecompressions = ChunkDecompressions;
+	stats.ChunkEvictions = ChunkEvictions;
+	stats.ChunkPageOuts = ChunkPageOuts;
+	stats.PendingPageIns = PendingPageIns.Num();
+	stats.AsyncPageIns = AsyncPageIns;
+	{
+		FScopeLock lock(&PageOutLock);
+		stats.PendingPageOuts = PendingPageOuts.Num();
+	}
+	stats.PageOutsReclaimed = PageOutsReclaimed;
+	stats.CompressedCacheHits = CompressedChunkCache.GetHits();
+	stats.CompressedCacheMisses = CompressedChunkCache.GetMisses();
+	if (stats.CompressedCacheHits + stats.CompressedCacheMisses > 0)
+	{
+		stats.CompressedCacheHitRate = (float)stats.CompressedCacheHits / (float)(stats.CompressedCacheHits + stats.CompressedCacheMisses);
+	}
+	stats.CompressedCacheChunks = CompressedChunkCache.Num();
+	stats.CompressedCacheBytes = (int32)CompressedChunkCache.GetBytes();
+	stats.CompressedCacheEvictions = CompressedChunkCache.GetEvictions();
+	stats.ChunkCacheHits = ChunkCacheHits.GetValue();
+	stats.ChunkCacheMisses = ChunkCacheMisses.GetValue();
+	if (GameThreadAccessor.IsValid())
+	{
+		stats.ChunkCacheHits += GameThreadAccessor->GetCacheHits();
+		stats.ChunkCacheMisses += GameThreadAccessor->GetCacheMisses();
 	}
-	ArrayChunks.Empty();
+	stats.BufferPoolHits = ChunkBufferPool.GetHits();
+	stats.BufferPoolMisses = ChunkBufferPool.GetMisses();
+	stats.BufferPoolHighWaterBytes = (int32)ChunkBufferPool.GetHighWaterBytes();
+	stats.BufferPoolFreeBytes = (int32)ChunkBufferPool.GetPooledBytes();
+	return stats;
 }
 
-int32 UPagedVolumeComponent::CalculateSizeInBytes() const
+bool UPagedVolumeComponent::IsRegionEmpty(const FRegion& Region)
 {
-	uint32_t uChunkCount = 0;
-	for (uint32_t uIndex = 0; uIndex < CHUNK_ARRAY_SIZE; uIndex++)
+	for (int32 chunkZ = Region.LowerZ >> ChunkSideLengthPower; chunkZ <= (Region.UpperZ >> ChunkSideLengthPower); chunkZ++)
 	{
-		if (ArrayChunks[uIndex])
+		for (int32 chunkY = Region.LowerY >> ChunkSideLengthPower; chunkY <= (Region.UpperY >> ChunkSideLengthPower); chunkY++)
 		{
-			uChunkCount++;
+			for (int32 chunkX = Region.LowerX >> ChunkSideLengthPower; chunkX <= (Region.UpperX >> ChunkSideLengthPower); chunkX++)
+			{
+				// Pinned so it can't be compressed or evicted while its solidity is being read
+				FPagedChunkData* chunk = GetPinnedChunk(chunkX, chunkY, chunkZ);
+				if (chunk->IsUniform())
+				{
+					const bool bIsSolid = chunk->GetUniformVoxel().bIsSolid;
+					UnpinChunk(chunk);
+					if (bIsSolid)
+					{
+						return false;
+					}
+					continue;
+				}
+
+				// The part of the region which lies in this chunk, in chunk space
+				const int32 lowerX = FMath::Max(Region.LowerX - chunk->ChunkRegion.LowerX, 0);
+				const int32 lowerY = FMath::Max(Region.LowerY - chunk->ChunkRegion.LowerY, 0);
+				const int32 lowerZ = FMath::Max(Region.LowerZ - chunk->ChunkRegion.LowerZ, 0);
+				const int32 upperX = FMath::Min(Region.UpperX - chunk->ChunkRegion.LowerX, (int32)ChunkMask);
+				const int32 upperY = FMath::Min(Region.UpperY - chunk->ChunkRegion.LowerY, (int32)ChunkMask);
+				const int32 upperZ = FMath::Min(Region.UpperZ - chunk->ChunkRegion.LowerZ, (int32)ChunkMask);
+
+				// Test up to 64 voxels at a time along each row
+				for (int32 z = lowerZ; z <= upperZ; z++)
+				{
+					for (int32 y = lowerY; y <= upperY; y++)
+					{
+						for (int32 x = lowerX; x <= upperX; x += 64)
+						{
+							if (chunk->GetSolidityBitsAlongX(x, y, z, FMath::Min(upperX - x + 1, 64)) != 0)
+							{
+								UnpinChunk(chunk);
+								return false;
+							}
+						}
+					}
+				}
+				UnpinChunk(chunk);
+			}
 		}
 	}
+	return true;
+}
 
-	// Note: We disregard the size of the other class members as they are likely to be very small compared to the size of the
-	// allocated voxel data. This also keeps the reported size as a power of two, which makes other memory calculations easier.
-	return APagedChunk::CalculateSizeInBytes(ChunkSideLength) * uChunkCount;
+bool UPagedVolumeComponent::IsRegionUniformlySolidOrEmpty(const FRegion& Region, bool bPageIn /*= true*/)
+{
+	const int32 startX = Region.LowerX >> ChunkSideLengthPower;
+	const int32 startY = Region.LowerY >> ChunkSideLengthPower;
+	const int32 startZ = Region.LowerZ >> ChunkSideLengthPower;
+	const int32 endX = Region.UpperX >> ChunkSideLengthPower;
+	const int32 endY = Region.UpperY >> ChunkSideLengthPower;
+	const int32 endZ = Region.UpperZ >> ChunkSideLengthPower;
+
+	bool bFirstChunk = true;
+	bool bIsSolid = false;
+	for (int32 z = startZ; z <= endZ; z++)
+	{
+		for (int32 y = startY; y <= endY; y++)
+		{
+			for (int32 x = startX; x <= endX; x++)
+			{
+				FPagedChunkData* chunk = bPageIn ? GetPinnedChunk(x, y, z) : GetPinnedChunkIfResident(x, y, z);
+				if (chunk == NULL)
+				{
+					return false;
+				}
+				const bool bChunkIsSolid = chunk->IsAllSolid();
+				const bool bChunkIsAir = chunk->IsAllAir();
+				UnpinChunk(chunk);
+
+				// Chunks with mixed materials still count, so long as the solidity never changes
+				if (!bChunkIsSolid && !bChunkIsAir)
+				{
+					return false;
+				}
+				if (bFirstChunk)
+				{
+					bIsSolid = bChunkIsSolid;
+					bFirstChunk = false;
+				}
+				else if (bChunkIsSolid != bIsSolid)
+				{
+					return false;
+				}
+			}
+		}
+	}
+	return true;
 }
 
 void UPagedVolumeComponent::CreateMarchingCubesMesh(FRegion Region, TArray<FVoxelMaterial> VoxelMaterials)
 {
 	ChunkMaterials = VoxelMaterials;
-	TArray<APagedChunk*> chunks = Prefetch(Region);
+	TArray<FIntVector> chunks = Prefetch(Region);
 	for (int i = 0; i < chunks.Num(); i++)
 	{
 		// Queue the chunks; Tick will handle the actual chunk loading
@@ -340,117 +1347,234 @@ uint8 UPagedVolumeComponent::GetSideLengthPower() const
 	return ChunkSideLengthPower;
 }
 
-APagedChunk* UPagedVolumeComponent::GetLastAccessedChunk() const
+uint8 UPagedVolumeComponent::GetMeshBlockSideLengthPower() const
+{
+	return FMath::Min(ChunkSideLengthPower, MESH_BLOCK_SIDE_LENGTH_POWER);
+}
+
+uint8 UPagedVolumeComponent::GetBrickSideLengthPower() const
+{
+	return FMath::Min(ChunkSideLengthPower, FPagedChunkData::BRICK_SIDE_LENGTH_POWER);
+}
+
+EBrickOccupancy UPagedVolumeComponent::GetBrickOccupancy(int32 BrickX, int32 BrickY, int32 BrickZ, bool bPageIn /*= true*/)
 {
-	return LastAccessedChunk;
+	const uint8 bricksPerChunkPower = ChunkSideLengthPower - GetBrickSideLengthPower();
+	const int32 brickMask = (1 << bricksPerChunkPower) - 1;
+	const int32 chunkX = BrickX >> bricksPerChunkPower;
+	const int32 chunkY = BrickY >> bricksPerChunkPower;
+	const int32 chunkZ = BrickZ >> bricksPerChunkPower;
+
+	// Either way the chunk is pinned, so it can't be compressed or evicted while its bricks are being read
+	FPagedChunkData* chunk = bPageIn ? GetPinnedChunk(chunkX, chunkY, chunkZ) : GetPinnedChunkIfResident(chunkX, chunkY, chunkZ);
+	if (chunk == NULL)
+	{
+		return EBrickOccupancy::Mixed;
+	}
+	const EBrickOccupancy occupancy = chunk->GetBrickOccupancy(BrickX & brickMask, BrickY & brickMask, BrickZ & brickMask);
+	UnpinChunk(chunk);
+	return occupancy;
 }
 
-bool UPagedVolumeComponent::CanReuseLastAccessedChunk(int32 ChunkX, int32 ChunkY, int32 ChunkZ) const
+FPagedChunkData* UPagedVolumeComponent::FindChunk(int32 ChunkX, int32 ChunkY, int32 ChunkZ) const
 {
-	return ((ChunkX == LastAccessedChunkX) &&
-		(ChunkY == LastAccessedChunkY) &&
-		(ChunkZ == LastAccessedChunkZ) &&
-		(LastAccessedChunk != NULL));
+	ChunkTableLock.ReadLock();
+	FPagedChunkData* chunk = ChunkTable.Find(ChunkX, ChunkY, ChunkZ);
+	ChunkTableLock.ReadUnlock();
+	return chunk;
 }
 
-APagedChunk* UPagedVolumeComponent::GetChunk(int32 ChunkX, int32 ChunkY, int32 ChunkZ)
+FPagedChunkData* UPagedVolumeComponent::GetChunk(int32 ChunkX, int32 ChunkY, int32 ChunkZ)
 {
-	APagedChunk* chunk = nullptr;
+	return FindOrLoadChunk(ChunkX, ChunkY, ChunkZ, false);
+}
 
-	// Extract the lower five bits from each position component.
-	const uint32 chunkXLowerBits = static_cast<uint32>(ChunkX & 0x1F);
-	const uint32 chunkYLowerBits = static_cast<uint32>(ChunkY & 0x1F);
-	const uint32 chunkZLowerBits = static_cast<uint32>(ChunkZ & 0x1F);
-	// Combine then to form a 15-bit hash of the position. Also shift by one to spread the values out in the whole 16-bit space.
-	const uint32 posisionHash = (((chunkXLowerBits)) | ((chunkYLowerBits) << 5) | ((chunkZLowerBits) << 10) << 1);
+FPagedChunkData* UPagedVolumeComponent::GetPinnedChunk(int32 ChunkX, int32 ChunkY, int32 ChunkZ)
+{
+	return FindOrLoadChunk(ChunkX, ChunkY, ChunkZ, true);
+}
 
-	// Starting at the position indicated by the hash, and then search through the whole array looking for a chunk with the correct
-	// position. In most cases we expect to find it in the first place we look. Note that this algorithm is slow in the case that
-	// the chunk is not found because the whole array has to be searched, but in this case we are going to have to page the data in
-	// from an external source which is likely to be slow anyway.
-	uint32 iIndex = posisionHash;
-	do
+FPagedChunkData* UPagedVolumeComponent::FindOrLoadChunk(int32 ChunkX, int32 ChunkY, int32 ChunkZ, bool bPin)
+{
+	const FIntVector position(ChunkX, ChunkY, ChunkZ);
+	FPagedChunkData* chunk = NULL;
+	while (true)
 	{
-		if (ArrayChunks[iIndex] != NULL)
+		// Most of the time the chunk is resident and uncompressed, and any number of threads can find it at once.
+		ChunkTableLock.ReadLock();
+		chunk = ChunkTable.Find(ChunkX, ChunkY, ChunkZ);
+		if (chunk != NULL && !chunk->IsCompressed())
 		{
-			FVector& entryPos = ArrayChunks[iIndex]->ChunkSpacePosition;
-			if (entryPos.X == ChunkX && entryPos.Y == ChunkY && entryPos.Z == ChunkZ)
+			if (bPin)
 			{
-				chunk = ArrayChunks[iIndex];
-				chunk->bDueToBePagedOut = false;
-				break;
+				chunk->PinCount.Increment();
 			}
+			chunk->LastAccessTick = CurrentTick;
+			MarkChunkUsed(chunk);
+			ChunkTableLock.ReadUnlock();
+			return chunk;
 		}
+		ChunkTableLock.ReadUnlock();
 
-		iIndex++;
-		iIndex %= CHUNK_ARRAY_SIZE;
-	} while (iIndex != posisionHash); // Keep searching until we get back to our start position.
-
-									  // If we still haven't found the chunk then it's time to create a new one and page it in from disk.
-	if (chunk == NULL)
-	{
-		// The chunk was not found so we will create a new one.
-		FVector chunkPos(ChunkX, ChunkY, ChunkZ);
-		chunk = GetWorld()->SpawnActor<APagedChunk>();
-		chunk->InitChunk(chunkPos, ChunkSideLength, Pager, VoxelSize, RandomSeed);
-		chunk->bDueToBePagedOut = false;
+		// The chunk was not found so we will create a new one and page it in from disk. This is the slow part, so it
+		// is done without holding the lock. If it is still waiting to be paged out, there's nothing to load.
+		FPagedChunkData* newChunk = NULL;
+		uint32 pageOutGeneration = 0;
+		if (chunk == NULL)
+		{
+			WaitForPageOut(position);
+			{
+				FScopeLock lock(&PageOutLock);
+				pageOutGeneration = PageOutGeneration;
+			}
+			if (!IsPageOutQueued(position))
+			{
+				newChunk = new FPagedChunkData();
+				LoadChunk(newChunk, position);
+			}
+		}
 
-		// Store the chunk at the appropriate place in out chunk array. Ideally this place is
-		// given by the hash, otherwise we do a linear search for the next available location
-		// We always expect to find a free place because we aim to keep the array only half full.
-		iIndex = posisionHash;
-		bool bInsertedSucessfully = false;
-		do
+		ChunkTableLock.WriteLock();
+		// Things may have changed while the lock was released.
+		chunk = ChunkTable.Find(ChunkX, ChunkY, ChunkZ);
+		if (chunk == NULL)
+		{
+			// A copy waiting to be paged out is always newer than anything the pager has.
+			chunk = ReclaimPageOut(position);
+		}
+		if (chunk == NULL)
+		{
+			bool bMayBeStale = true;
+			if (newChunk != NULL)
+			{
+				FScopeLock lock(&PageOutLock);
+				bMayBeStale = PageOutGeneration != pageOutGeneration;
+			}
+			if (bMayBeStale)
+			{
+				// Either it was compressed when we looked and has been evicted since, or something may have paged it
+				// out while we were loading it. Start again.
+				ChunkTableLock.WriteUnlock();
+				delete newChunk;
+				continue;
+			}
+			chunk = newChunk;
+			ChunkTable.Add(chunk);
+		}
+		else
 		{
-			if (ArrayChunks[iIndex] == NULL)
+			// Another thread paged it in first. Ours hasn't been modified, so it can be thrown away.
+			delete newChunk;
+			if (chunk->IsCompressed())
 			{
-				ArrayChunks[iIndex] = chunk;
-				bInsertedSucessfully = true;
-				break;
+				chunk->Decompress();
+				ChunkDecompressions++;
 			}
+		}
+		break;
+	}
+	if (bPin)
+	{
+		chunk->PinCount.Increment();
+	}
+	chunk->LastAccessTick = CurrentTick;
+	MarkChunkUsed(chunk);
+	ChunkTableLock.WriteUnlock();
+
+	return chunk;
+}
 
-			iIndex++;
-			iIndex %= CHUNK_ARRAY_SIZE;
-		} while (iIndex != posisionHash); // Keep searching until we get back to our start position.
+FPagedChunkData* UPagedVolumeComponent::GetPinnedChunkIfResident(int32 ChunkX, int32 ChunkY, int32 ChunkZ)
+{
+	ChunkTableLock.ReadLock();
+	FPagedChunkData* chunk = ChunkTable.Find(ChunkX, ChunkY, ChunkZ);
+	if (chunk != NULL && !chunk->IsCompressed())
+	{
+		chunk->PinCount.Increment();
+		chunk->LastAccessTick = CurrentTick;
+		MarkChunkUsed(chunk);
+		ChunkTableLock.ReadUnlock();
+		return chunk;
+	}
+	ChunkTableLock.ReadUnlock();
+	if (chunk == NULL)
+	{
+		return NULL;
+	}
 
-										  // This should never really happen unless we are failing to keep our number of active chunks
-										  // significantly under the target amount. Perhaps if chunks are 'pinned' for threading purposes?
-		if (!bInsertedSucessfully)
+	// It's resident, just compressed. Decompressing it only changes the chunk, not the table.
+	ChunkTableLock.WriteLock();
+	chunk = ChunkTable.Find(ChunkX, ChunkY, ChunkZ);
+	if (chunk != NULL)
+	{
+		if (chunk->IsCompressed())
 		{
-			UE_LOG(LogPolyVox, Fatal, TEXT("No space in chunk array for new chunk."));
-			return NULL;
+			chunk->Decompress();
+			ChunkDecompressions++;
 		}
+		chunk->PinCount.Increment();
+		chunk->LastAccessTick = CurrentTick;
+		MarkChunkUsed(chunk);
 	}
+	ChunkTableLock.WriteUnlock();
+	return chunk;
+}
 
-	LastAccessedChunk = chunk;
-	LastAccessedChunkX = ChunkX;
-	LastAccessedChunkY = ChunkY;
-	LastAccessedChunkZ = ChunkZ;
+void UPagedVolumeComponent::PinChunk(FPagedChunkData* Chunk)
+{
+	Chunk->PinCount.Increment();
+}
 
-	return chunk;
+void UPagedVolumeComponent::UnpinChunk(FPagedChunkData* Chunk)
+{
+	// The chunk may have been read many times through the accessor without being stamped.
+	Chunk->LastAccessTick = CurrentTick;
+	Chunk->PinCount.Decrement();
+}
+
+FVolumeAccessor& UPagedVolumeComponent::GetGameThreadAccessor()
+{
+	if (!GameThreadAccessor.IsValid())
+	{
+		GameThreadAccessor = MakeUnique<FVolumeAccessor>(this);
+	}
+	return *GameThreadAccessor;
 }
 
 
 void UPagedVolumeComponent::FlattenRegionToHeight(const FRegion& Region, const int32 Height, FVoxel Filler)
 {
-	for (int x = Region.LowerX; x < Region.UpperX; x++)
+	const FVoxel empty = FVoxel::GetEmptyVoxel();
+	VisitRegion(Region, [&](FChunkRegionView& View)
 	{
-		for (int y = Region.LowerY; y < Region.UpperY; y++)
+		const FIntVector& origin = View.GetChunkOrigin();
+		const FIntVector& lower = View.GetLower();
+		const FIntVector& upper = View.GetUpper();
+		for (int32 z = lower.Z; z <= upper.Z; z++)
 		{
-			for (int z = Region.LowerZ; z < Region.UpperZ; z++)
+			const bool bBelowHeight = origin.Z + z <= Height;
+			if (View.IsUniform() && View.GetUniformVoxel().bIsSolid == bBelowHeight)
 			{
-				FVoxel voxel = GetVoxelByCoordinates(x, y, z);
-				if (z <= Height && !voxel.bIsSolid)
-				{
-					SetVoxelByCoordinates(x, y, z, Filler);
-				}
-				else if (z > Height && voxel.bIsSolid)
+				// Already flat at this depth
+				continue;
+			}
+			for (int32 y = lower.Y; y <= upper.Y; y++)
+			{
+				for (int32 x = lower.X; x <= upper.X; x++)
 				{
-					SetVoxelByCoordinates(x, y, z, FVoxel::GetEmptyVoxel());
+					FVoxel voxel = View.GetVoxel(x, y, z);
+					if (bBelowHeight && !voxel.bIsSolid)
+					{
+						View.SetVoxel(x, y, z, Filler);
+					}
+					else if (!bBelowHeight && voxel.bIsSolid)
+					{
+						View.SetVoxel(x, y, z, empty);
+					}
 				}
 			}
 		}
-	}
+	});
 }
 
 void UPagedVolumeComponent::SetRegionHeightmap(const FRegion& Region, const TArray<float>& Heights, FVoxel Filler)
@@ -463,25 +1587,27 @@ void UPagedVolumeComponent::SetRegionHeightmap(const FRegion& Region, const TArr
 		// TODO Resize
 	}
 
-	for (int x = Region.LowerX; x < Region.UpperX; x++)
+	// Columns are indexed by the region's X and Y, but written with the two swapped
+	FRegion stampRegion = Region;
+	stampRegion.LowerX = Region.LowerY;
+	stampRegion.UpperX = Region.UpperY;
+	stampRegion.LowerY = Region.LowerX;
+	stampRegion.UpperY = Region.UpperX;
+
+	TArray<int32> columnHeights;
+	TArray<FVoxel> columnFillers;
+	columnHeights.SetNumUninitialized(URegionHelper::GetWidthInCells(stampRegion) * URegionHelper::GetHeightInCells(stampRegion));
+	columnFillers.Init(Filler, columnHeights.Num());
+	int32 column = 0;
+	for (int y = stampRegion.LowerY; y < stampRegion.UpperY; y++)
 	{
-		for (int y = Region.LowerY; y < Region.UpperY; y++)
+		for (int x = stampRegion.LowerX; x < stampRegion.UpperX; x++, column++)
 		{
-			float targetHeightPercent = UArrayHelper::Get2DFloat(Heights, x, y, regionWidth);
-			int32 targetHeight = FMath::CeilToInt(URegionHelper::GetDepthInCells(Region) * targetHeightPercent);
-			for (int z = Region.LowerZ; z < Region.UpperZ; z++)
-			{
-				if (z <= targetHeight)
-				{
-					SetVoxelByCoordinates(y, x, z, Filler);
-				}
-				else
-				{
-					SetVoxelByCoordinates(y, x, z, FVoxel::GetEmptyVoxel());
-				}
-			}
+			float targetHeightPercent = UArrayHelper::Get2DFloat(Heights, y, x, regionWidth);
+			columnHeights[column] = FMath::CeilToInt(URegionHelper::GetDepthInCells(Region) * targetHeightPercent);
 		}
 	}
+	StampColumns(stampRegion, columnHeights, columnFillers);
 }
 
 void UPagedVolumeComponent::SetRegionVoxels(const FRegion& Region, const TArray<float>& Heights, const TArray<uint8>& Materials)
@@ -494,27 +1620,80 @@ void UPagedVolumeComponent::SetRegionVoxels(const FRegion& Region, const TArray<
 	int32 regionWidth = URegionHelper::GetWidthInCells(Region);
 	int32 regionDepth = URegionHelper::GetDepthInCells(Region);
 
-	for (int x = Region.LowerX; x < Region.UpperX; x++)
+	// Columns are indexed by the region's X and Y, but written with the two swapped
+	FRegion stampRegion = Region;
+	stampRegion.LowerX = Region.LowerY;
+	stampRegion.UpperX = Region.UpperY;
+	stampRegion.LowerY = Region.LowerX;
+	stampRegion.UpperY = Region.UpperX;
+
+	TArray<int32> columnHeights;
+	TArray<FVoxel> columnFillers;
+	columnHeights.SetNumUninitialized(URegionHelper::GetWidthInCells(stampRegion) * URegionHelper::GetHeightInCells(stampRegion));
+	columnFillers.SetNumUninitialized(columnHeights.Num());
+	int32 column = 0;
+	for (int y = stampRegion.LowerY; y < stampRegion.UpperY; y++)
+	{
+		for (int x = stampRegion.LowerX; x < stampRegion.UpperX; x++, column++)
+		{
+			uint8 targetMaterial = UArrayHelper::Get2DUint8(Materials, y, x, regionWidth);
+			float targetHeightPercent = UArrayHelper::Get2DFloat(Heights, y, x, regionWidth);
+			columnHeights[column] = Region.LowerZ + FMath::RoundToInt(regionDepth * targetHeightPercent);
+			columnFillers[column] = FVoxel::MakeVoxel(targetMaterial, true);
+		}
+	}
+	StampColumns(stampRegion, columnHeights, columnFillers);
+}
+
+void UPagedVolumeComponent::StampColumns(const FRegion& Region, const TArray<int32>& ColumnHeights, const TArray<FVoxel>& ColumnFillers)
+{
+	const int32 regionWidth = URegionHelper::GetWidthInCells(Region);
+	const FVoxel empty = FVoxel::GetEmptyVoxel();
+	VisitRegion(Region, [&](FChunkRegionView& View)
 	{
-		for (int y = Region.LowerY; y < Region.UpperY; y++)
+		const FIntVector& origin = View.GetChunkOrigin();
+		const FIntVector& lower = View.GetLower();
+		const FIntVector& upper = View.GetUpper();
+		const int32 firstColumn = (origin.X + lower.X - Region.LowerX) + (origin.Y + lower.Y - Region.LowerY) * regionWidth;
+
+		// Most chunks are entirely above or below the surface, and can be filled without looking at each voxel
+		int32 minHeight = MAX_int32;
+		int32 maxHeight = MIN_int32;
+		bool bSameFiller = true;
+		for (int32 y = 0; y <= upper.Y - lower.Y; y++)
 		{
-			uint8 targetMaterial = UArrayHelper::Get2DUint8(Materials, x, y, regionWidth);
-			
-			float targetHeightPercent = UArrayHelper::Get2DFloat(Heights, x, y, regionWidth);
-			int32 targetHeight = Region.LowerZ + FMath::RoundToInt(regionDepth * targetHeightPercent);
-			for (int z = Region.LowerZ; z < Region.UpperZ; z++)
+			for (int32 x = 0; x <= upper.X - lower.X; x++)
 			{
-				if (z <= targetHeight)
-				{
-					SetVoxelByCoordinates(y, x, z, FVoxel::MakeVoxel(targetMaterial, true));
-				}
-				else
+				const int32 column = firstColumn + x + y * regionWidth;
+				minHeight = FMath::Min(minHeight, ColumnHeights[column]);
+				maxHeight = FMath::Max(maxHeight, ColumnHeights[column]);
+				bSameFiller &= ColumnFillers[column] == ColumnFillers[firstColumn];
+			}
+		}
+		if (origin.Z + lower.Z > maxHeight)
+		{
+			View.Fill(empty);
+			return;
+		}
+		if (origin.Z + upper.Z <= minHeight && bSameFiller)
+		{
+			View.Fill(ColumnFillers[firstColumn]);
+			return;
+		}
+
+		for (int32 y = lower.Y; y <= upper.Y; y++)
+		{
+			for (int32 x = lower.X; x <= upper.X; x++)
+			{
+				const int32 column = firstColumn + (x - lower.X) + (y - lower.Y) * regionWidth;
+				const int32 height = ColumnHeights[column] - origin.Z;
+				for (int32 z = lower.Z; z <= upper.Z; z++)
 				{
-					SetVoxelByCoordinates(y, x, z, FVoxel::GetEmptyVoxel());
+					View.SetVoxel(x, y, z, z <= height ? ColumnFillers[column] : empty);
 				}
 			}
 		}
-	}
+	});
 }
 
 void UPagedVolumeComponent::SetHeightmapFromImage(UTexture2D* Texture, FIntVector StartingPoint, int32 RegionHeight, FVoxel Filler)
@@ -574,57 +1753,96 @@ void UPagedVolumeComponent::SetHeightmapFromImage(UTexture2D* Texture, FIntVecto
 
 void UPagedVolumeComponent::SetRegionMaterials(const FRegion& Region, const TArray<uint8>& Materials, int32 BeginAtDepth, int32 PenetrateDistance)
 {
-	for (int x = Region.LowerX; x < Region.UpperX; x++)
+	const int32 regionWidth = URegionHelper::GetWidthInCells(Region);
+	const int32 materialsWidth = URegionHelper::GetWidthInVoxels(Region);
+
+	// How far down each column has got, carried from one chunk to the next as we work down the region
+	TArray<int32> columnDepths;
+	columnDepths.Init(-1, regionWidth * URegionHelper::GetHeightInCells(Region));
+	// Marks a column which has been painted as deep as it is going to go
+	const int32 columnDone = MIN_int32;
+
+	VisitRegion(Region, [&](FChunkRegionView& View)
 	{
-		for (int y = Region.LowerY; y < Region.UpperY; y++)
+		if (View.IsUniform() && !View.GetUniformVoxel().bIsSolid)
+		{
+			// Nothing to paint, and no depth to count
+			return;
+		}
+
+		const FIntVector& origin = View.GetChunkOrigin();
+		const FIntVector& lower = View.GetLower();
+		const FIntVector& upper = View.GetUpper();
+		for (int32 y = lower.Y; y <= upper.Y; y++)
 		{
-			int32 currentVoxelDepth = -1;
-			// We go "backwards" and start from the top of the region downward
-			for (int z = Region.UpperZ - 1; z >= Region.LowerZ; z--)
+			for (int32 x = lower.X; x <= upper.X; x++)
 			{
-				FVoxel voxel = GetVoxelByCoordinates(x, y, z);
-				if (voxel.bIsSolid)
+				const int32 worldX = origin.X + x;
+				const int32 worldY = origin.Y + y;
+				const int32 column = (worldX - Region.LowerX) + (worldY - Region.LowerY) * regionWidth;
+				int32& currentVoxelDepth = columnDepths[column];
+				if (currentVoxelDepth == columnDone)
 				{
-					currentVoxelDepth++;
-					if (currentVoxelDepth >= BeginAtDepth && currentVoxelDepth < PenetrateDistance)
-					{
-						voxel.Material = UArrayHelper::Get2DUint8(Materials, x, y, URegionHelper::GetWidthInVoxels(Region));
-						SetVoxelByCoordinates(x, y, z, voxel);
-					}
-					else if (currentVoxelDepth + BeginAtDepth >= PenetrateDistance)
+					continue;
+				}
+
+				// We go "backwards" and start from the top of the region downward
+				for (int32 z = upper.Z; z >= lower.Z; z--)
+				{
+					FVoxel voxel = View.GetVoxel(x, y, z);
+					if (voxel.bIsSolid)
 					{
-						break;
+						currentVoxelDepth++;
+						if (currentVoxelDepth >= BeginAtDepth && currentVoxelDepth < PenetrateDistance)
+						{
+							voxel.Material = UArrayHelper::Get2DUint8(Materials, worldX, worldY, materialsWidth);
+							View.SetVoxel(x, y, z, voxel);
+						}
+						else if (currentVoxelDepth + BeginAtDepth >= PenetrateDistance)
+						{
+							currentVoxelDepth = columnDone;
+							break;
+						}
 					}
 				}
 			}
 		}
-
-	}
+	}, true);
 }
 
 void UPagedVolumeComponent::DrawVolumeAsDebug(const FRegion& DebugRegion)
 {
-	for (int x = DebugRegion.LowerX; x < DebugRegion.UpperX; x++)
+	VisitRegion(DebugRegion, [&](FChunkRegionView& View)
 	{
-		for (int y = DebugRegion.LowerY; y < DebugRegion.UpperY; y++)
+		if (View.IsUniform() && !View.GetUniformVoxel().bIsSolid)
+		{
+			return;
+		}
+
+		const FIntVector& origin = View.GetChunkOrigin();
+		const FIntVector& lower = View.GetLower();
+		const FIntVector& upper = View.GetUpper();
+		for (int32 z = lower.Z; z <= upper.Z; z++)
 		{
-			for (int z = DebugRegion.LowerZ; z < DebugRegion.UpperZ; z++)
+			for (int32 y = lower.Y; y <= upper.Y; y++)
 			{
-				FVoxel voxel = GetVoxelByCoordinates(x, y, z);
-				if (!voxel.bIsSolid)
-				{
-					continue;
-				}
-				else
+				for (int32 x = lower.X; x <= upper.X; x++)
 				{
-					FVoxel neighbor = GetVoxelByCoordinates(x, y, z + 1);
+					FVoxel voxel = View.GetVoxel(x, y, z);
+					if (!voxel.bIsSolid)
+					{
+						continue;
+					}
+
+					// The voxel above the top layer is in the next chunk up
+					FVoxel neighbor = z < ChunkMask ? View.GetVoxel(x, y, z + 1) : GetVoxelByCoordinates(origin.X + x, origin.Y + y, origin.Z + z + 1);
 					if (neighbor.bIsSolid)
 					{
 						continue;
 					}
 					FColor color = FColor::Red;
 
-					FVector v0 = FVector(x * VoxelSize, y * VoxelSize, z * VoxelSize);
+					FVector v0 = FVector((origin.X + x) * VoxelSize, (origin.Y + y) * VoxelSize, (origin.Z + z) * VoxelSize);
 					FVector v1 = FVector(v0.X, v0.Y + VoxelSize, v0.Z);
 					FVector v2 = FVector(v0.X + VoxelSize, v0.Y, v0.Z);
 					FVector v3 = FVector(v2.X, v1.Y, v0.Z);
@@ -637,5 +1855,96 @@ void UPagedVolumeComponent::DrawVolumeAsDebug(const FRegion& DebugRegion)
 				}
 			}
 		}
+	});
+}
+float UPagedVolumeComponent::ComparePageInBatching(int32 ChunkCount /*= 256*/)
+{
+	if (Pager == NULL || ChunkCount <= 0)
+	{
+		return 0.0f;
+	}
+
+	const float singleRate = MeasurePageInRate(ChunkCount, false);
+	const float batchedRate = MeasurePageInRate(ChunkCount, true);
+	const float speedup = singleRate > 0.0f ? batchedRate / singleRate : 0.0f;
+	UE_LOG(LogPolyVox, Log, TEXT("PageInBatch() filled chunks %.2f times as fast as PageIn() (%.1f vs %.1f chunks per second)."), speedup, batchedRate, singleRate);
+	return speedup;
+}
+
+float UPagedVolumeComponent::MeasurePageInRate(int32 ChunkCount, bool bBatched)
+{
+	// A square of chunks at ground level, so column-based pagers get neighbours to share work between
+	const int32 gridSide = FMath::CeilToInt(FMath::Sqrt((float)ChunkCount));
+	TArray<FPagedChunkData*> chunks;
+	for (int32 i = 0; i < ChunkCount; i++)
+	{
+		FPagedChunkData* chunk = new FPagedChunkData();
+		chunk->PrepareForPageIn(FIntVector(i % gridSide, i / gridSide, 0), ChunkSideLength, Pager, RandomSeed, &ChunkBufferPool);
+		chunks.Add(chunk);
+	}
+
+	// The chunks never go in the table, so nothing is taken from the compressed cache either
+	const double startTime = FPlatformTime::Seconds();
+	if (bBatched)
+	{
+		for (int32 first = 0; first < ChunkCount; first += PAGE_IN_BATCH_SIZE)
+		{
+			TArray<FPagedChunkData*> batch(chunks.GetData() + first, FMath::Min(PAGE_IN_BATCH_SIZE, ChunkCount - first));
+			Pager->PageInBatch(batch);
+		}
+	}
+	else
+	{
+		for (int32 i = 0; i < ChunkCount; i++)
+		{
+			Pager->PageIn(chunks[i]->ChunkRegion, chunks[i]);
+		}
+	}
+	const double elapsedSeconds = FPlatformTime::Seconds() - startTime;
+
+	for (int32 i = 0; i < ChunkCount; i++)
+	{
+		delete chunks[i];
+	}
+
+	const float chunksPerSecond = elapsedSeconds > 0.0 ? (float)(ChunkCount / elapsedSeconds) : 0.0f;
+	UE_LOG(LogPolyVox, Log, TEXT("Paged in %d chunks %s in %.3f seconds (%.1f chunks per second)."), ChunkCount, bBatched ? TEXT("through PageInBatch()") : TEXT("through PageIn() one at a time"), elapsedSeconds, chunksPerSecond);
+	return chunksPerSecond;
+}
+
+float UPagedVolumeComponent::MeasureSamplerReadRate(int32 Passes /*= 16*/)
+{
+	if (Pager == NULL || Passes <= 0)
+	{
+		return 0.0f;
+	}
+
+	// Page the chunk in first, so only the reads are timed
+	GetChunk(0, 0, 0);
+	const int32 sideLength = ChunkSideLength;
+	int32 solidVoxels = 0;
+	const double startTime = FPlatformTime::Seconds();
+	for (int32 pass = 0; pass < Passes; pass++)
+	{
+		UVolumeSampler sampler(this);
+		for (int32 z = 0; z < sideLength; z++)
+		{
+			for (int32 y = 0; y < sideLength; y++)
+			{
+				sampler.SetPosition(0, y, z);
+				for (int32 x = 0; x < sideLength; x++)
+				{
+					solidVoxels += sampler.GetVoxel().bIsSolid ? 1 : 0;
+					sampler.MovePositiveX();
+				}
+			}
+		}
 	}
+	const double elapsedSeconds = FPlatformTime::Seconds() - startTime;
+
+	// The solid count is logged so that the reads can't be optimized away
+	const double reads = (double)Passes * sideLength * sideLength * sideLength;
+	const float readsPerSecond = elapsedSeconds > 0.0 ? (float)(reads / elapsedSeconds) : 0.0f;
+	UE_LOG(LogPolyVox, Log, TEXT("Read %.0f voxels (%d solid) in %.3f seconds (%.1f million voxels per second)."), reads, solidVoxels, elapsedSeconds, readsPerSecond / 1000000.0f);
+	return readsPerSecond;
 }
\ No newline at end of file
@@ -24,16 +24,53 @@ SOFTWARE.
 *******************************************************************************/
 
 #include "PolyVoxPrivatePCH.h"
+#include "PagedChunkData.h"
 #include "Pager.h"
 
 
 
-void UPager::PageIn_Implementation(const FRegion& Region, APagedChunk* Chunk)
+void UPager::PageIn(const FRegion& Region, FPagedChunkData* Chunk)
 {
-	// Empty
+	if (!GetClass()->IsFunctionImplementedInBlueprint(GET_FUNCTION_NAME_CHECKED(UPager, ReceivePageIn)))
+	{
+		return;
+	}
+	checkf(IsInGameThread(), TEXT("Blueprint pagers can only page chunks in on the game thread."));
+
+	TArray<FVoxel> voxels;
+	voxels.Init(FVoxel::GetEmptyVoxel(), Chunk->GetVoxelCount());
+	ReceivePageIn(Region, voxels);
+	if (voxels.Num() != Chunk->GetVoxelCount())
+	{
+		UE_LOG(LogPolyVox, Warning, TEXT("%s handed back %d voxels for a chunk of %d; the chunk was left empty."), *GetName(), voxels.Num(), Chunk->GetVoxelCount());
+		return;
+	}
+	Chunk->CopyFromLinear(voxels);
+}
+
+void UPager::PageInBatch(const TArray<FPagedChunkData*>& Chunks)
+{
+	for (int32 i = 0; i < Chunks.Num(); i++)
+	{
+		PageIn(Chunks[i]->ChunkRegion, Chunks[i]);
+	}
+}
+
+void UPager::PageOut(const FRegion& Region, FPagedChunkData* Chunk)
+{
+	if (!GetClass()->IsFunctionImplementedInBlueprint(GET_FUNCTION_NAME_CHECKED(UPager, ReceivePageOut)))
+	{
+		return;
+	}
+	checkf(IsInGameThread(), TEXT("Blueprint pagers can only page chunks out on the game thread."));
+
+	TArray<FVoxel> voxels;
+	Chunk->CopyToLinear(voxels);
+	ReceivePageOut(Region, voxels);
 }
 
-void UPager::PageOut_Implementation(const FRegion& Region, APagedChunk* Chunk)
+bool UPager::IsImplementedInBlueprint() const
 {
-	// Empty
+	return GetClass()->IsFunctionImplementedInBlueprint(GET_FUNCTION_NAME_CHECKED(UPager, ReceivePageIn)) ||
+		GetClass()->IsFunctionImplementedInBlueprint(GET_FUNCTION_NAME_CHECKED(UPager, ReceivePageOut));
 }
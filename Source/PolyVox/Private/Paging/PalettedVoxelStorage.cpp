@@ -0,0 +1,518 @@
+/*******************************************************************************
+The MIT License (MIT)
+
+Copyright (c) 2017 Jay Stevens
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*******************************************************************************/
+
+#include "PolyVoxPrivatePCH.h"
+#include "ChunkBufferPool.h"
+#include "PalettedVoxelStorage.h"
+
+FPalettedVoxelStorage::FPalettedVoxelStorage()
+{
+	BufferPool = nullptr;
+	VoxelCount = 0;
+	LastPaletteIndex = 0;
+	SetIndexWidth(0);
+}
+
+FPalettedVoxelStorage::~FPalettedVoxelStorage()
+{
+	FreeWords(IndexWords);
+}
+
+void FPalettedVoxelStorage::SetBufferPool(FChunkBufferPool* Pool)
+{
+	// Anything allocated so far came from the old pool (or the heap), so give it back before switching
+	FreeWords(IndexWords);
+	SetIndexWidth(0);
+	BufferPool = Pool;
+}
+
+void FPalettedVoxelStorage::Init(int32 NumberOfVoxels, FVoxel Fill /*= FVoxel::GetEmptyVoxel()*/)
+{
+	Palette.Empty();
+	Palette.Add(Fill);
+	LastPaletteIndex = 0;
+	VoxelCount = NumberOfVoxels;
+
+	// Every voxel is the same, so no indices are needed until something different is written
+	FreeWords(IndexWords);
+	SetIndexWidth(0);
+}
+
+bool FPalettedVoxelStorage::IsUniform() const
+{
+	return BitsPerIndex == 0;
+}
+
+void FPalettedVoxelStorage::Empty()
+{
+	Palette.Empty();
+	FreeWords(IndexWords);
+	VoxelCount = 0;
+	LastPaletteIndex = 0;
+	SetIndexWidth(0);
+}
+
+int32 FPalettedVoxelStorage::Num() const
+{
+	return VoxelCount;
+}
+
+void FPalettedVoxelStorage::Set(uint32 Index, FVoxel Value)
+{
+	checkf(Index < (uint32)VoxelCount, TEXT("Voxel index %d out of bounds of voxel data size %d!"), Index, VoxelCount);
+
+	const uint64 paletteIndex = (uint64)FindOrAddPaletteEntry(Value);
+	if (BitsPerIndex == 0)
+	{
+		// Writing the value a uniform chunk already has
+		return;
+	}
+	const uint32 word = Index >> IndicesPerWordPower;
+	const uint32 shift = (Index & IndicesPerWordMask) * BitsPerIndex;
+	IndexWords[word] = (IndexWords[word] & ~(IndexMask << shift)) | (paletteIndex << shift);
+}
+
+void FPalettedVoxelStorage::SetMasked(const TArray<uint64>& Mask, FVoxel Value)
+{
+	checkf(Mask.Num() == (VoxelCount + 63) >> 6, TEXT("Mask has %d words, but %d voxels need %d."), Mask.Num(), VoxelCount, (VoxelCount + 63) >> 6);
+
+	const uint64 paletteIndex = (uint64)FindOrAddPaletteEntry(Value);
+	if (BitsPerIndex == 0)
+	{
+		// Writing the value a uniform chunk already has
+		return;
+	}
+
+	if (BitsPerIndex == 1)
+	{
+		// With 1-bit indices the mask lines up exactly with the index words
+		for (int32 i = 0; i < Mask.Num(); i++)
+		{
+			IndexWords[i] = paletteIndex != 0 ? (IndexWords[i] | Mask[i]) : (IndexWords[i] & ~Mask[i]);
+		}
+		return;
+	}
+
+	// A full mask word covers BitsPerIndex whole index words, which can just be overwritten
+	uint64 filledWord = 0;
+	for (uint32 i = 0; i <= IndicesPerWordMask; i++)
+	{
+		filledWord |= paletteIndex << (i * BitsPerIndex);
+	}
+	for (int32 i = 0; i < Mask.Num(); i++)
+	{
+		const uint64 bits = Mask[i];
+		if (bits == 0)
+		{
+			continue;
+		}
+		else if (bits == ~0ull)
+		{
+			for (int32 word = i * BitsPerIndex; word < (i + 1) * BitsPerIndex; word++)
+			{
+				IndexWords[word] = filledWord;
+			}
+			continue;
+		}
+		for (uint32 bit = 0; bit < 64; bit++)
+		{
+			if ((bits & (1ull << bit)) != 0)
+			{
+				const uint32 index = ((uint32)i << 6) + bit;
+				const uint32 shift = (index & IndicesPerWordMask) * BitsPerIndex;
+				uint64& word = IndexWords[index >> IndicesPerWordPower];
+				word = (word & ~(IndexMask << shift)) | (paletteIndex << shift);
+			}
+		}
+	}
+}
+
+void FPalettedVoxelStorage::SetAll(const FVoxel* Values)
+{
+	if (VoxelCount == 0)
+	{
+		return;
+	}
+
+	// Build the palette first, so the indices only have to be packed once at their final width
+	TArray<FVoxel> palette;
+	TArray<uint16> indices;
+	indices.SetNumUninitialized(VoxelCount);
+	palette.Add(Values[0]);
+	int32 lastIndex = 0;
+	for (int32 i = 0; i < VoxelCount; i++)
+	{
+		if (!(palette[lastIndex] == Values[i]))
+		{
+			lastIndex = palette.Find(Values[i]);
+			if (lastIndex == INDEX_NONE)
+			{
+				lastIndex = palette.Add(Values[i]);
+			}
+		}
+		indices[i] = (uint16)lastIndex;
+	}
+
+	Init(VoxelCount, palette[0]);
+	Palette = MoveTemp(palette);
+	if (Palette.Num() == 1)
+	{
+		return;
+	}
+
+	SetIndexWidth(GetBitsForPaletteSize(Palette.Num()));
+	AllocateWords(IndexWords, (VoxelCount + IndicesPerWordMask) >> IndicesPerWordPower);
+	for (int32 i = 0; i < VoxelCount; i++)
+	{
+		IndexWords[i >> IndicesPerWordPower] |= (uint64)indices[i] << ((i & IndicesPerWordMask) * BitsPerIndex);
+	}
+}
+
+void FPalettedVoxelStorage::Compact()
+{
+	if (VoxelCount == 0 || BitsPerIndex == 0)
+	{
+		return;
+	}
+
+	// Find out which palette entries are actually referenced
+	TArray<int32> useCounts;
+	useCounts.SetNumZeroed(Palette.Num());
+	if (BitsPerIndex == 1)
+	{
+		// Unused bits are always zero, so the set bits are exactly the voxels using the second entry
+		for (int32 i = 0; i < IndexWords.Num(); i++)
+		{
+			useCounts[1] += FMath::CountBits(IndexWords[i]);
+		}
+		useCounts[0] = VoxelCount - useCounts[1];
+	}
+	else
+	{
+		for (int32 i = 0; i < VoxelCount; i++)
+		{
+			const uint32 shift = (i & IndicesPerWordMask) * BitsPerIndex;
+			useCounts[(int32)((IndexWords[i >> IndicesPerWordPower] >> shift) & IndexMask)]++;
+		}
+	}
+
+	TArray<FVoxel> newPalette;
+	TArray<uint16> remap;
+	remap.SetNumZeroed(Palette.Num());
+	for (int32 i = 0; i < Palette.Num(); i++)
+	{
+		if (useCounts[i] > 0)
+		{
+			remap[i] = (uint16)newPalette.Num();
+			newPalette.Add(Palette[i]);
+		}
+	}
+	if (newPalette.Num() == Palette.Num())
+	{
+		// Nothing to remove
+		return;
+	}
+
+	// Rewrite every index against the new palette, at the (possibly smaller) new width
+	Repack(GetBitsForPaletteSize(newPalette.Num()), &remap);
+	Palette = MoveTemp(newPalette);
+	LastPaletteIndex = 0;
+}
+
+// Run lengths and palette indices are stored as LEB128-style variable length integers, since almost all of them are small.
+static void WriteVarInt(TArray<uint8>& Bytes, uint32 Value)
+{
+	while (Value >= 0x80)
+	{
+		Bytes.Add((uint8)(Value | 0x80));
+		Value >>= 7;
+	}
+	Bytes.Add((uint8)Value);
+}
+
+static bool ReadVarInt(const TArray<uint8>& Bytes, int32& Offset, uint32& OutValue)
+{
+	OutValue = 0;
+	for (int32 shift = 0; shift < 35; shift += 7)
+	{
+		if (Offset >= Bytes.Num())
+		{
+			return false;
+		}
+		const uint8 byte = Bytes[Offset++];
+		OutValue |= (uint32)(byte & 0x7F) << shift;
+		if ((byte & 0x80) == 0)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+void FPalettedVoxelStorage::CompressRLE(TArray<uint8>& OutBytes) const
+{
+	// Layout: voxel count, palette size, palette entries (material, solid), then (run length, palette index) pairs
+	OutBytes.Reset();
+	WriteVarInt(OutBytes, (uint32)VoxelCount);
+	WriteVarInt(OutBytes, (uint32)Palette.Num());
+	for (int32 i = 0; i < Palette.Num(); i++)
+	{
+		OutBytes.Add(Palette[i].Material);
+		OutBytes.Add(Palette[i].bIsSolid ? 1 : 0);
+	}
+
+	if (VoxelCount == 0 || BitsPerIndex == 0)
+	{
+		// A uniform store is just its palette
+		return;
+	}
+
+	uint32 runIndex = (uint32)(IndexWords[0] & IndexMask);
+	uint32 runLength = 0;
+	for (int32 i = 0; i < VoxelCount; i++)
+	{
+		const uint32 shift = (i & IndicesPerWordMask) * BitsPerIndex;
+		const uint32 paletteIndex = (uint32)((IndexWords[i >> IndicesPerWordPower] >> shift) & IndexMask);
+		if (paletteIndex != runIndex)
+		{
+			WriteVarInt(OutBytes, runLength);
+			WriteVarInt(OutBytes, runIndex);
+			runIndex = paletteIndex;
+			runLength = 0;
+		}
+		runLength++;
+	}
+	WriteVarInt(OutBytes, runLength);
+	WriteVarInt(OutBytes, runIndex);
+}
+
+bool FPalettedVoxelStorage::DecompressRLE(const TArray<uint8>& InBytes, int32 ExpectedVoxelCount)
+{
+	int32 offset = 0;
+	uint32 voxelCount = 0;
+	uint32 paletteSize = 0;
+	if (!ReadVarInt(InBytes, offset, voxelCount) || !ReadVarInt(InBytes, offset, paletteSize) || paletteSize == 0 || paletteSize > 512)
+	{
+		return false;
+	}
+	// The data may have come off disk, so nothing in it is trusted to size the store
+	if (voxelCount != (uint32)ExpectedVoxelCount || offset + (int32)paletteSize * 2 > InBytes.Num())
+	{
+		return false;
+	}
+
+	TArray<FVoxel> palette;
+	palette.Reserve(paletteSize);
+	for (uint32 i = 0; i < paletteSize; i++)
+	{
+		palette.Add(FVoxel::MakeVoxel(InBytes[offset], InBytes[offset + 1] != 0));
+		offset += 2;
+	}
+
+	// Check every run fits before anything is written, so bad data leaves the store alone
+	const int32 runsOffset = offset;
+	if (paletteSize > 1)
+	{
+		uint32 voxel = 0;
+		while (voxel < voxelCount)
+		{
+			uint32 runLength = 0;
+			uint32 paletteIndex = 0;
+			if (!ReadVarInt(InBytes, offset, runLength) || !ReadVarInt(InBytes, offset, paletteIndex) ||
+				paletteIndex >= paletteSize || runLength == 0 || runLength > voxelCount - voxel)
+			{
+				return false;
+			}
+			voxel += runLength;
+		}
+	}
+
+	Init((int32)voxelCount, palette[0]);
+	Palette = MoveTemp(palette);
+	if (Palette.Num() == 1)
+	{
+		return true;
+	}
+
+	SetIndexWidth(GetBitsForPaletteSize(Palette.Num()));
+	AllocateWords(IndexWords, (VoxelCount + IndicesPerWordMask) >> IndicesPerWordPower);
+
+	offset = runsOffset;
+	int32 voxel = 0;
+	while (voxel < VoxelCount)
+	{
+		uint32 runLength = 0;
+		uint32 paletteIndex = 0;
+		ReadVarInt(InBytes, offset, runLength);
+		ReadVarInt(InBytes, offset, paletteIndex);
+		for (uint32 i = 0; i < runLength; i++, voxel++)
+		{
+			IndexWords[voxel >> IndicesPerWordPower] |= (uint64)paletteIndex << ((voxel & IndicesPerWordMask) * BitsPerIndex);
+		}
+	}
+	return true;
+}
+
+int32 FPalettedVoxelStorage::GetPaletteSize() const
+{
+	return Palette.Num();
+}
+
+uint8 FPalettedVoxelStorage::GetBitsPerIndex() const
+{
+	return BitsPerIndex;
+}
+
+int32 FPalettedVoxelStorage::GetSizeInBytes() const
+{
+	return Palette.Num() * sizeof(FVoxel) + IndexWords.Num() * sizeof(uint64);
+}
+
+int32 FPalettedVoxelStorage::FindOrAddPaletteEntry(const FVoxel& Value)
+{
+	if (Palette[LastPaletteIndex] == Value)
+	{
+		return LastPaletteIndex;
+	}
+	for (int32 i = 0; i < Palette.Num(); i++)
+	{
+		if (Palette[i] == Value)
+		{
+			LastPaletteIndex = i;
+			return i;
+		}
+	}
+
+	// This is a new value, so the indices may need to be widened to fit it
+	LastPaletteIndex = Palette.Add(Value);
+	const uint8 neededBits = GetBitsForPaletteSize(Palette.Num());
+	if (neededBits != BitsPerIndex)
+	{
+		Repack(neededBits);
+	}
+	return LastPaletteIndex;
+}
+
+void FPalettedVoxelStorage::Repack(uint8 NewBitsPerIndex, const TArray<uint16>* Remap /*= nullptr*/)
+{
+	if (NewBitsPerIndex == 0)
+	{
+		// Only one value left, so the indices can go
+		FreeWords(IndexWords);
+		SetIndexWidth(0);
+		return;
+	}
+
+	const uint8 oldBitsPerIndex = BitsPerIndex;
+	const uint8 oldPower = IndicesPerWordPower;
+	const uint32 oldPerWordMask = IndicesPerWordMask;
+	const uint64 oldIndexMask = IndexMask;
+	TArray<uint64> oldWords = MoveTemp(IndexWords);
+
+	SetIndexWidth(NewBitsPerIndex);
+	AllocateWords(IndexWords, (VoxelCount + IndicesPerWordMask) >> IndicesPerWordPower);
+	if (oldBitsPerIndex == 0)
+	{
+		// Expanding a uniform chunk; every voxel points at palette entry 0, which is what zeroed words already say
+		return;
+	}
+
+	for (int32 i = 0; i < VoxelCount; i++)
+	{
+		const uint32 shift = (i & oldPerWordMask) * oldBitsPerIndex;
+		uint64 paletteIndex = (oldWords[i >> oldPower] >> shift) & oldIndexMask;
+		if (Remap != nullptr)
+		{
+			paletteIndex = (*Remap)[(int32)paletteIndex];
+		}
+		IndexWords[i >> IndicesPerWordPower] |= paletteIndex << ((i & IndicesPerWordMask) * BitsPerIndex);
+	}
+	FreeWords(oldWords);
+}
+
+void FPalettedVoxelStorage::AllocateWords(TArray<uint64>& Words, int32 NumWords)
+{
+	if (BufferPool != nullptr)
+	{
+		BufferPool->Acquire(NumWords, Words);
+	}
+	else
+	{
+		Words.Empty(NumWords);
+		Words.SetNumZeroed(NumWords);
+	}
+}
+
+void FPalettedVoxelStorage::FreeWords(TArray<uint64>& Words)
+{
+	if (BufferPool != nullptr)
+	{
+		BufferPool->Release(Words);
+	}
+	else
+	{
+		Words.Empty();
+	}
+}
+
+void FPalettedVoxelStorage::SetIndexWidth(uint8 NewBitsPerIndex)
+{
+	BitsPerIndex = NewBitsPerIndex;
+	if (BitsPerIndex == 0)
+	{
+		IndicesPerWordPower = 0;
+		IndicesPerWordMask = 0;
+		IndexMask = 0;
+		return;
+	}
+	IndicesPerWordPower = (uint8)FMath::Log2(64 / BitsPerIndex);
+	IndicesPerWordMask = (1u << IndicesPerWordPower) - 1;
+	IndexMask = (1ull << BitsPerIndex) - 1;
+}
+
+uint8 FPalettedVoxelStorage::GetBitsForPaletteSize(int32 PaletteSize)
+{
+	if (PaletteSize <= 1)
+	{
+		return 0;
+	}
+	else if (PaletteSize <= 2)
+	{
+		return 1;
+	}
+	else if (PaletteSize <= 4)
+	{
+		return 2;
+	}
+	else if (PaletteSize <= 16)
+	{
+		return 4;
+	}
+	else if (PaletteSize <= 256)
+	{
+		return 8;
+	}
+	// An FVoxel only has 512 possible values, so this is as wide as we ever need to go
+	return 16;
+}
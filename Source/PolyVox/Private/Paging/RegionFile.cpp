@@ -0,0 +1,367 @@
+/*******************************************************************************
+The MIT License (MIT)
+
+Copyright (c) 2017 Jay Stevens
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*******************************************************************************/
+
+#include "PolyVoxPrivatePCH.h"
+#include "HAL/PlatformFilemanager.h"
+#include "GenericPlatform/GenericPlatformFile.h"
+#include "Misc/Crc.h"
+#include "Misc/Paths.h"
+#include "RegionHelper.h"
+#include "RegionFile.h"
+
+// "PVRG", followed by the format version, the chunk side length and the region side length power
+static const uint32 REGION_FILE_MAGIC = 0x47525650;
+static const uint32 REGION_FILE_VERSION = 2;
+static const int32 REGION_HEADER_SIZE = 4 * sizeof(uint32);
+static const int32 REGION_ENTRY_SIZE = 4 * sizeof(uint32);
+static const int32 REGION_TABLE_END = REGION_HEADER_SIZE + FRegionFile::CHUNKS_PER_REGION * REGION_ENTRY_SIZE;
+// Space for chunk data is handed out in multiples of this, with an eighth extra on top, so a chunk can usually grow
+// a little and stay where it is. Saved edits can be only a few bytes, so this is kept small.
+static const uint32 REGION_SECTOR_SIZE = 32;
+
+// The file is always little-endian, whatever platform wrote it
+static void WriteUint32(uint8* Bytes, uint32 Value)
+{
+	Bytes[0] = (uint8)(Value);
+	Bytes[1] = (uint8)(Value >> 8);
+	Bytes[2] = (uint8)(Value >> 16);
+	Bytes[3] = (uint8)(Value >> 24);
+}
+
+static uint32 ReadUint32(const uint8* Bytes)
+{
+	return (uint32)Bytes[0] | ((uint32)Bytes[1] << 8) | ((uint32)Bytes[2] << 16) | ((uint32)Bytes[3] << 24);
+}
+
+FRegionFile::FRegionFile(const FString& RegionFilePath, uint8 RegionChunkSideLength)
+{
+	FilePath = RegionFilePath;
+	ChunkSideLength = RegionChunkSideLength;
+	bIsWritable = false;
+	bIsIncompatible = false;
+	EndOfFile = REGION_TABLE_END;
+}
+
+FRegionFile::~FRegionFile()
+{
+	// Closing the handle flushes anything still buffered
+	FileHandle.Reset();
+}
+
+FIntVector FRegionFile::GetRegionPosition(const FIntVector& ChunkPosition)
+{
+	return FIntVector(ChunkPosition.X >> REGION_SIDE_LENGTH_POWER, ChunkPosition.Y >> REGION_SIDE_LENGTH_POWER, ChunkPosition.Z >> REGION_SIDE_LENGTH_POWER);
+}
+
+int32 FRegionFile::GetEntryIndex(const FIntVector& ChunkPosition)
+{
+	const int32 mask = (1 << REGION_SIDE_LENGTH_POWER) - 1;
+	return (ChunkPosition.X & mask) | ((ChunkPosition.Y & mask) << REGION_SIDE_LENGTH_POWER) | ((ChunkPosition.Z & mask) << (REGION_SIDE_LENGTH_POWER * 2));
+}
+
+bool FRegionFile::ReadChunk(const FIntVector& ChunkPosition, TArray<uint8>& OutBytes)
+{
+	FScopeLock lock(&FileLock);
+	if (!OpenFile(false))
+	{
+		return false;
+	}
+
+	const FChunkEntry& entry = Entries[GetEntryIndex(ChunkPosition)];
+	if (entry.Size == 0)
+	{
+		return false;
+	}
+
+	OutBytes.SetNumUninitialized(entry.Size);
+	if (!FileHandle->Seek(entry.Offset) || !FileHandle->Read(OutBytes.GetData(), entry.Size))
+	{
+		UE_LOG(LogPolyVox, Warning, TEXT("Could not read chunk (%d, %d, %d) from %s."), ChunkPosition.X, ChunkPosition.Y, ChunkPosition.Z, *FilePath);
+		OutBytes.Reset();
+		return false;
+	}
+	if (FCrc::MemCrc32(OutBytes.GetData(), OutBytes.Num()) != entry.Checksum)
+	{
+		UE_LOG(LogPolyVox, Warning, TEXT("Saved data for chunk (%d, %d, %d) in %s is corrupt and will be regenerated."), ChunkPosition.X, ChunkPosition.Y, ChunkPosition.Z, *FilePath);
+		OutBytes.Reset();
+		return false;
+	}
+	return true;
+}
+
+bool FRegionFile::WriteChunk(const FIntVector& ChunkPosition, const TArray<uint8>& Bytes)
+{
+	if (Bytes.Num() == 0)
+	{
+		return false;
+	}
+
+	FScopeLock lock(&FileLock);
+	if (!OpenFile(true))
+	{
+		return false;
+	}
+
+	const int32 index = GetEntryIndex(ChunkPosition);
+	const FChunkEntry oldEntry = Entries[index];
+	FChunkEntry& entry = Entries[index];
+	entry.Capacity = Align((uint32)Bytes.Num() + Bytes.Num() / 8, REGION_SECTOR_SIZE);
+	entry.Offset = AllocateSpace(entry.Capacity);
+	entry.Size = Bytes.Num();
+	entry.Checksum = FCrc::MemCrc32(Bytes.GetData(), Bytes.Num());
+
+	// The old data is never written over. The new data goes somewhere unused first, and only then is the entry
+	// pointed at it, so until the entry is written the table still points at the old data, intact.
+	if (!FileHandle->Seek(entry.Offset) || !FileHandle->Write(Bytes.GetData(), Bytes.Num()))
+	{
+		UE_LOG(LogPolyVox, Error, TEXT("Could not save chunk (%d, %d, %d) to %s."), ChunkPosition.X, ChunkPosition.Y, ChunkPosition.Z, *FilePath);
+		ReleaseSpace(entry.Offset, entry.Capacity);
+		entry = oldEntry;
+		return false;
+	}
+	if (!WriteEntry(index))
+	{
+		// We can't tell which entry made it to disk, so neither space can be handed out again until the table is
+		// next read
+		UE_LOG(LogPolyVox, Error, TEXT("Could not save chunk (%d, %d, %d) to %s."), ChunkPosition.X, ChunkPosition.Y, ChunkPosition.Z, *FilePath);
+		entry = oldEntry;
+		return false;
+	}
+	if (oldEntry.Capacity > 0)
+	{
+		ReleaseSpace(oldEntry.Offset, oldEntry.Capacity);
+	}
+	return true;
+}
+
+void FRegionFile::Close()
+{
+	FScopeLock lock(&FileLock);
+	FileHandle.Reset();
+	bIsWritable = false;
+	Entries.Empty();
+	FreeSpans.Empty();
+}
+
+uint32 FRegionFile::AllocateSpace(uint32 Length)
+{
+	for (int32 i = 0; i < FreeSpans.Num(); i++)
+	{
+		FFreeSpan& span = FreeSpans[i];
+		if (span.Length >= Length)
+		{
+			const uint32 offset = span.Offset;
+			span.Offset += Length;
+			span.Length -= Length;
+			if (span.Length == 0)
+			{
+				FreeSpans.RemoveAt(i);
+			}
+			return offset;
+		}
+	}
+	const uint32 offset = EndOfFile;
+	EndOfFile += Length;
+	return offset;
+}
+
+void FRegionFile::ReleaseSpace(uint32 Offset, uint32 Length)
+{
+	if (Offset + Length == EndOfFile)
+	{
+		// Nothing comes after it, so the end of the file can just move back
+		EndOfFile = Offset;
+		if (FreeSpans.Num() > 0 && FreeSpans.Last().Offset + FreeSpans.Last().Length == EndOfFile)
+		{
+			EndOfFile = FreeSpans.Last().Offset;
+			FreeSpans.Pop(false);
+		}
+		return;
+	}
+
+	int32 index = 0;
+	while (index < FreeSpans.Num() && FreeSpans[index].Offset < Offset)
+	{
+		index++;
+	}
+	FFreeSpan span;
+	span.Offset = Offset;
+	span.Length = Length;
+	FreeSpans.Insert(span, index);
+
+	if (index + 1 < FreeSpans.Num() && FreeSpans[index].Offset + FreeSpans[index].Length == FreeSpans[index + 1].Offset)
+	{
+		FreeSpans[index].Length += FreeSpans[index + 1].Length;
+		FreeSpans.RemoveAt(index + 1);
+	}
+	if (index > 0 && FreeSpans[index - 1].Offset + FreeSpans[index - 1].Length == FreeSpans[index].Offset)
+	{
+		FreeSpans[index - 1].Length += FreeSpans[index].Length;
+		FreeSpans.RemoveAt(index);
+	}
+}
+
+bool FRegionFile::OpenFile(bool bForWriting)
+{
+	if (bIsIncompatible)
+	{
+		return false;
+	}
+	if (FileHandle.IsValid() && (bIsWritable || !bForWriting))
+	{
+		return true;
+	}
+
+	IPlatformFile& platformFile = FPlatformFileManager::Get().GetPlatformFile();
+	if (!bForWriting)
+	{
+		FileHandle.Reset(platformFile.OpenRead(*FilePath));
+		if (!FileHandle.IsValid())
+		{
+			// Nothing in this region has been saved yet
+			return false;
+		}
+		return ReadTable();
+	}
+
+	// Anything we read before is still valid, so the table only needs reading if this is the first time in
+	const bool bHasTable = FileHandle.IsValid();
+	FileHandle.Reset();
+	platformFile.CreateDirectoryTree(*FPaths::GetPath(FilePath));
+	FileHandle.Reset(platformFile.OpenWrite(*FilePath, true, true));
+	if (!FileHandle.IsValid())
+	{
+		UE_LOG(LogPolyVox, Error, TEXT("Could not open %s for writing."), *FilePath);
+		return false;
+	}
+	bIsWritable = true;
+
+	if (FileHandle->Size() == 0)
+	{
+		Entries.SetNumZeroed(CHUNKS_PER_REGION);
+		EndOfFile = REGION_TABLE_END;
+		FreeSpans.Reset();
+		return WriteTable();
+	}
+	return bHasTable || ReadTable();
+}
+
+bool FRegionFile::ReadTable()
+{
+	const int64 fileSize = FileHandle->Size();
+	TArray<uint8> table;
+	table.SetNumUninitialized(REGION_TABLE_END);
+	if (fileSize < REGION_TABLE_END || !FileHandle->Seek(0) || !FileHandle->Read(table.GetData(), REGION_TABLE_END))
+	{
+		UE_LOG(LogPolyVox, Warning, TEXT("%s is truncated and will be ignored."), *FilePath);
+		bIsIncompatible = true;
+		FileHandle.Reset();
+		return false;
+	}
+
+	const uint8* header = table.GetData();
+	if (ReadUint32(header) != REGION_FILE_MAGIC || ReadUint32(header + 4) != REGION_FILE_VERSION ||
+		ReadUint32(header + 8) != ChunkSideLength || ReadUint32(header + 12) != REGION_SIDE_LENGTH_POWER)
+	{
+		UE_LOG(LogPolyVox, Warning, TEXT("%s was saved by a different version or with a different chunk size, and will be ignored."), *FilePath);
+		bIsIncompatible = true;
+		FileHandle.Reset();
+		return false;
+	}
+
+	Entries.SetNumUninitialized(CHUNKS_PER_REGION);
+	EndOfFile = REGION_TABLE_END;
+	FreeSpans.Reset();
+	for (int32 i = 0; i < CHUNKS_PER_REGION; i++)
+	{
+		const uint8* bytes = table.GetData() + REGION_HEADER_SIZE + i * REGION_ENTRY_SIZE;
+		FChunkEntry& entry = Entries[i];
+		entry.Offset = ReadUint32(bytes);
+		entry.Capacity = ReadUint32(bytes + 4);
+		entry.Size = ReadUint32(bytes + 8);
+		entry.Checksum = ReadUint32(bytes + 12);
+		// Only the data is ever written, so the file can end before a chunk's reserved space does
+		if (entry.Size > entry.Capacity || entry.Offset < (uint32)REGION_TABLE_END || (int64)entry.Offset + entry.Size > fileSize)
+		{
+			// Left over from a write which never finished; that chunk will just be generated again.
+			FMemory::Memzero(entry);
+			continue;
+		}
+		EndOfFile = FMath::Max(EndOfFile, entry.Offset + entry.Capacity);
+	}
+
+	// Whatever lies between the chunks' spaces was left behind by chunks which have since moved, and can be reused
+	TArray<FChunkEntry> usedSpace;
+	for (const FChunkEntry& entry : Entries)
+	{
+		if (entry.Capacity > 0)
+		{
+			usedSpace.Add(entry);
+		}
+	}
+	usedSpace.Sort([](const FChunkEntry& A, const FChunkEntry& B) { return A.Offset < B.Offset; });
+	uint32 usedUpTo = REGION_TABLE_END;
+	for (const FChunkEntry& entry : usedSpace)
+	{
+		if (entry.Offset > usedUpTo)
+		{
+			FFreeSpan span;
+			span.Offset = usedUpTo;
+			span.Length = entry.Offset - usedUpTo;
+			FreeSpans.Add(span);
+		}
+		usedUpTo = FMath::Max(usedUpTo, entry.Offset + entry.Capacity);
+	}
+	return true;
+}
+
+bool FRegionFile::WriteTable()
+{
+	TArray<uint8> table;
+	table.SetNumZeroed(REGION_TABLE_END);
+	uint8* header = table.GetData();
+	WriteUint32(header, REGION_FILE_MAGIC);
+	WriteUint32(header + 4, REGION_FILE_VERSION);
+	WriteUint32(header + 8, ChunkSideLength);
+	WriteUint32(header + 12, REGION_SIDE_LENGTH_POWER);
+	for (int32 i = 0; i < CHUNKS_PER_REGION; i++)
+	{
+		uint8* bytes = table.GetData() + REGION_HEADER_SIZE + i * REGION_ENTRY_SIZE;
+		WriteUint32(bytes, Entries[i].Offset);
+		WriteUint32(bytes + 4, Entries[i].Capacity);
+		WriteUint32(bytes + 8, Entries[i].Size);
+		WriteUint32(bytes + 12, Entries[i].Checksum);
+	}
+	return FileHandle->Seek(0) && FileHandle->Write(table.GetData(), table.Num());
+}
+
+bool FRegionFile::WriteEntry(int32 Index)
+{
+	uint8 bytes[REGION_ENTRY_SIZE];
+	WriteUint32(bytes, Entries[Index].Offset);
+	WriteUint32(bytes + 4, Entries[Index].Capacity);
+	WriteUint32(bytes + 8, Entries[Index].Size);
+	WriteUint32(bytes + 12, Entries[Index].Checksum);
+	return FileHandle->Seek(REGION_HEADER_SIZE + Index * REGION_ENTRY_SIZE) && FileHandle->Write(bytes, REGION_ENTRY_SIZE);
+}
@@ -0,0 +1,302 @@
+/*******************************************************************************
+The MIT License (MIT)
+
+Copyright (c) 2017 Jay Stevens
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*******************************************************************************/
+
+#include "PolyVoxPrivatePCH.h"
+#include "Misc/Paths.h"
+#include "PagedChunkData.h"
+#include "RegionFile.h"
+#include "RegionFilePager.h"
+
+// Each saved chunk starts with one of these, saying what follows
+enum class ESavedChunkFormat : uint8
+{
+	// Everything from FPagedChunkData::SerializeVoxels()
+	WholeChunk,
+	// The chunk's seed, the number of edits, then a (gap from the previous index, material, solid) triple
+	// for each changed voxel in ascending Morton order
+	EditsOnly
+};
+
+// How many region files may be open at once. A volume streaming around a moving player only touches a few regions
+// at a time, but over a long session it would otherwise end up holding a handle to every region it ever visited.
+static const int32 MAX_OPEN_REGION_FILES = 64;
+
+static void WriteVarInt(TArray<uint8>& Bytes, uint32 Value)
+{
+	while (Value >= 0x80)
+	{
+		Bytes.Add((uint8)(Value | 0x80));
+		Value >>= 7;
+	}
+	Bytes.Add((uint8)Value);
+}
+
+static bool ReadVarInt(const TArray<uint8>& Bytes, int32& Offset, uint32& OutValue)
+{
+	OutValue = 0;
+	for (uint32 shift = 0; shift < 35; shift += 7)
+	{
+		if (Offset >= Bytes.Num())
+		{
+			return false;
+		}
+		const uint8 byte = Bytes[Offset++];
+		OutValue |= (uint32)(byte & 0x7F) << shift;
+		if ((byte & 0x80) == 0)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+URegionFilePager::URegionFilePager()
+{
+	SaveFolder = TEXT("Voxels");
+	bSaveEditsOnly = false;
+	Generator = nullptr;
+}
+
+void URegionFilePager::PostInitProperties()
+{
+	Super::PostInitProperties();
+
+	// Pages come in on worker threads, where we can't create objects, so the generator has to be made up front.
+	if (!HasAnyFlags(RF_ClassDefaultObject) && GeneratorPager != NULL)
+	{
+		Generator = NewObject<UPager>(this, GeneratorPager, NAME_None);
+	}
+}
+
+void URegionFilePager::BeginDestroy()
+{
+	// Closing the files makes sure everything written to them is on disk.
+	FScopeLock lock(&RegionFilesLock);
+	for (auto& regionFile : RegionFiles)
+	{
+		delete regionFile.Value;
+	}
+	RegionFiles.Empty();
+	RecentlyUsedRegions.Empty();
+
+	Super::BeginDestroy();
+}
+
+FRegionFile* URegionFilePager::GetRegionFile(const FIntVector& ChunkPosition, uint8 ChunkSideLength)
+{
+	const FIntVector regionPosition = FRegionFile::GetRegionPosition(ChunkPosition);
+
+	FScopeLock lock(&RegionFilesLock);
+	const int32 recentIndex = RecentlyUsedRegions.Find(regionPosition);
+	if (recentIndex == RecentlyUsedRegions.Num() - 1 && recentIndex != INDEX_NONE)
+	{
+		// Still the most recently used, which is what happens for most chunks in a row
+		return RegionFiles.FindChecked(regionPosition);
+	}
+	if (recentIndex != INDEX_NONE)
+	{
+		RecentlyUsedRegions.RemoveAt(recentIndex, 1, false);
+	}
+	else if (RecentlyUsedRegions.Num() >= MAX_OPEN_REGION_FILES)
+	{
+		// A thread which is already reading or writing it will open it again, but it gets closed the next time it
+		// falls out of use
+		RegionFiles.FindChecked(RecentlyUsedRegions[0])->Close();
+		RecentlyUsedRegions.RemoveAt(0, 1, false);
+	}
+	RecentlyUsedRegions.Add(regionPosition);
+
+	FRegionFile** regionFile = RegionFiles.Find(regionPosition);
+	if (regionFile != NULL)
+	{
+		return *regionFile;
+	}
+
+	const FString fileName = FString::Printf(TEXT("r.%d.%d.%d.pvr"), regionPosition.X, regionPosition.Y, regionPosition.Z);
+	const FString filePath = FPaths::Combine(FPaths::GameSavedDir(), SaveFolder, fileName);
+	FRegionFile* newFile = new FRegionFile(filePath, ChunkSideLength);
+	RegionFiles.Add(regionPosition, newFile);
+	return newFile;
+}
+
+void URegionFilePager::PageIn(const FRegion& Region, FPagedChunkData* Chunk)
+{
+	TArray<FPagedChunkData*> chunks;
+	chunks.Add(Chunk);
+	PageInBatch(chunks);
+}
+
+void URegionFilePager::PageInBatch(const TArray<FPagedChunkData*>& Chunks)
+{
+	// Chunks saved whole are read straight back. Everything else is made by the generator in one batch, and chunks
+	// which were saved as edits get them put back on top afterwards.
+	TArray<FPagedChunkData*> chunksToGenerate;
+	TArray<TArray<uint8>> savedEdits;
+	for (int32 i = 0; i < Chunks.Num(); i++)
+	{
+		FPagedChunkData* chunk = Chunks[i];
+		const FIntVector& chunkPosition = chunk->GetChunkSpacePosition();
+		FRegionFile* regionFile = GetRegionFile(chunkPosition, (uint8)(chunk->ChunkRegion.UpperX - chunk->ChunkRegion.LowerX));
+
+		TArray<uint8> savedBytes;
+		if (regionFile->ReadChunk(chunkPosition, savedBytes))
+		{
+			if (savedBytes[0] == (uint8)ESavedChunkFormat::WholeChunk)
+			{
+				TArray<uint8> voxels(savedBytes.GetData() + 1, savedBytes.Num() - 1);
+				if (chunk->DeserializeVoxels(voxels))
+				{
+					continue;
+				}
+			}
+			else if (savedBytes[0] == (uint8)ESavedChunkFormat::EditsOnly)
+			{
+				chunksToGenerate.Add(chunk);
+				savedEdits.Add(MoveTemp(savedBytes));
+				continue;
+			}
+			UE_LOG(LogPolyVox, Warning, TEXT("Saved data for chunk (%d, %d, %d) could not be read and will be regenerated."), chunkPosition.X, chunkPosition.Y, chunkPosition.Z);
+			chunk->SetUniform(FVoxel::GetEmptyVoxel());
+		}
+
+		// Never saved (or the save was unreadable), so make it from scratch
+		chunksToGenerate.Add(chunk);
+		savedEdits.AddDefaulted();
+	}
+
+	if (Generator != NULL && chunksToGenerate.Num() > 0)
+	{
+		Generator->PageInBatch(chunksToGenerate);
+	}
+	for (int32 i = 0; i < chunksToGenerate.Num(); i++)
+	{
+		FPagedChunkData* chunk = chunksToGenerate[i];
+		if (savedEdits[i].Num() == 0 || ApplyEdits(chunk, savedEdits[i]))
+		{
+			continue;
+		}
+
+		// Some of the edits may have gone in before the problem turned up, so start again
+		const FIntVector& chunkPosition = chunk->GetChunkSpacePosition();
+		UE_LOG(LogPolyVox, Warning, TEXT("Saved data for chunk (%d, %d, %d) could not be read and will be regenerated."), chunkPosition.X, chunkPosition.Y, chunkPosition.Z);
+		chunk->SetUniform(FVoxel::GetEmptyVoxel());
+		if (Generator != NULL)
+		{
+			Generator->PageIn(chunk->ChunkRegion, chunk);
+		}
+	}
+}
+
+void URegionFilePager::PageOut(const FRegion& Region, FPagedChunkData* Chunk)
+{
+	const FIntVector& chunkPosition = Chunk->GetChunkSpacePosition();
+	FRegionFile* regionFile = GetRegionFile(chunkPosition, (uint8)(Region.UpperX - Region.LowerX));
+
+	TArray<uint8> voxels;
+	Chunk->SerializeVoxels(voxels);
+
+	TArray<uint8> savedBytes;
+	if (!bSaveEditsOnly || !SerializeEdits(Region, Chunk, voxels.Num(), savedBytes))
+	{
+		savedBytes.Reset(voxels.Num() + 1);
+		savedBytes.Add((uint8)ESavedChunkFormat::WholeChunk);
+		savedBytes.Append(voxels);
+	}
+	regionFile->WriteChunk(chunkPosition, savedBytes);
+}
+
+bool URegionFilePager::SerializeEdits(const FRegion& Region, FPagedChunkData* Chunk, int32 MaxBytes, TArray<uint8>& OutBytes)
+{
+	// Make the chunk again to see what it started out as. With no generator, everything starts out as air.
+	FPagedChunkData generatedChunk;
+	if (Generator != NULL)
+	{
+		generatedChunk.InitChunk(Chunk->GetChunkSpacePosition(), (uint8)(Region.UpperX - Region.LowerX), Generator, Chunk->RandomSeed);
+	}
+
+	TArray<uint8> edits;
+	uint32 editCount = 0;
+	int32 lastIndex = -1;
+	const int32 voxelCount = Chunk->GetVoxelCount();
+	for (int32 i = 0; i < voxelCount; i++)
+	{
+		const FVoxel voxel = Chunk->GetDataAtIndex(i);
+		const FVoxel generatedVoxel = Generator != NULL ? generatedChunk.GetDataAtIndex(i) : FVoxel::GetEmptyVoxel();
+		if (voxel == generatedVoxel)
+		{
+			continue;
+		}
+		WriteVarInt(edits, (uint32)(i - lastIndex - 1));
+		edits.Add(voxel.Material);
+		edits.Add(voxel.bIsSolid ? 1 : 0);
+		lastIndex = i;
+		editCount++;
+		if (edits.Num() >= MaxBytes)
+		{
+			// Edited too heavily to be worth it
+			return false;
+		}
+	}
+
+	OutBytes.Reset(edits.Num() + 10);
+	OutBytes.Add((uint8)ESavedChunkFormat::EditsOnly);
+	WriteVarInt(OutBytes, (uint32)Chunk->RandomSeed);
+	WriteVarInt(OutBytes, editCount);
+	OutBytes.Append(edits);
+	return true;
+}
+
+bool URegionFilePager::ApplyEdits(FPagedChunkData* Chunk, const TArray<uint8>& Bytes)
+{
+	int32 offset = 1;
+	uint32 seed = 0;
+	uint32 editCount = 0;
+	if (!ReadVarInt(Bytes, offset, seed) || !ReadVarInt(Bytes, offset, editCount))
+	{
+		return false;
+	}
+	if ((int32)seed != Chunk->RandomSeed)
+	{
+		UE_LOG(LogPolyVox, Warning, TEXT("Chunk (%d, %d, %d) was saved with a different seed, so its edits may not line up with the terrain."), Chunk->GetChunkSpacePosition().X, Chunk->GetChunkSpacePosition().Y, Chunk->GetChunkSpacePosition().Z);
+	}
+
+	const int32 voxelCount = Chunk->GetVoxelCount();
+	int32 index = -1;
+	for (uint32 i = 0; i < editCount; i++)
+	{
+		uint32 gap = 0;
+		if (!ReadVarInt(Bytes, offset, gap) || offset + 2 > Bytes.Num())
+		{
+			return false;
+		}
+		index += (int32)gap + 1;
+		if (index >= voxelCount)
+		{
+			return false;
+		}
+		Chunk->SetDataAtIndex(index, FVoxel::MakeVoxel(Bytes[offset], Bytes[offset + 1] != 0));
+		offset += 2;
+	}
+	return true;
+}
@@ -0,0 +1,163 @@
+/*******************************************************************************
+The MIT License (MIT)
+
+Copyright (c) 2017 Jay Stevens
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*******************************************************************************/
+
+#include "PolyVoxPrivatePCH.h"
+#include "PagedVolumeComponent.h"
+#include "PagedChunkData.h"
+#include "VolumeAccessor.h"
+
+FVolumeAccessor::FVolumeAccessor(UPagedVolumeComponent* VolumeData, bool bOnlyResidentChunks /*= false*/)
+{
+	checkf(VolumeData != NULL, TEXT("Provided volume cannot be null"));
+	Volume = VolumeData;
+	bResidentOnly = bOnlyResidentChunks;
+	FMemory::Memzero(Cache, sizeof(Cache));
+	CacheHits = 0;
+	CacheMisses = 0;
+}
+
+FVolumeAccessor::FVolumeAccessor(const FVolumeAccessor& Other)
+{
+	Volume = Other.Volume;
+	bResidentOnly = Other.bResidentOnly;
+	CopyCache(Other);
+}
+
+FVolumeAccessor& FVolumeAccessor::operator=(const FVolumeAccessor& Other)
+{
+	if (this != &Other)
+	{
+		Reset();
+		FlushCounters();
+		Volume = Other.Volume;
+		bResidentOnly = Other.bResidentOnly;
+		CopyCache(Other);
+	}
+	return *this;
+}
+
+FVolumeAccessor::~FVolumeAccessor()
+{
+	Reset();
+	FlushCounters();
+}
+
+FVoxel FVolumeAccessor::GetVoxel(int32 XPos, int32 YPos, int32 ZPos)
+{
+	const uint8 sideLengthPower = Volume->GetSideLengthPower();
+	const int32 chunkMask = (1 << sideLengthPower) - 1;
+	FPagedChunkData* chunk = GetChunk(XPos >> sideLengthPower, YPos >> sideLengthPower, ZPos >> sideLengthPower);
+	if (chunk == NULL)
+	{
+		// Only resident-only accessors get here
+		return FVoxel::GetEmptyVoxel();
+	}
+	return chunk->GetVoxelByCoordinatesChunkSpace(XPos & chunkMask, YPos & chunkMask, ZPos & chunkMask);
+}
+
+void FVolumeAccessor::SetVoxel(int32 XPos, int32 YPos, int32 ZPos, FVoxel Voxel)
+{
+	const uint8 sideLengthPower = Volume->GetSideLengthPower();
+	const int32 chunkMask = (1 << sideLengthPower) - 1;
+	const FIntVector chunkPos(XPos >> sideLengthPower, YPos >> sideLengthPower, ZPos >> sideLengthPower);
+	FPagedChunkData* chunk = GetChunk(chunkPos.X, chunkPos.Y, chunkPos.Z);
+	if (chunk == NULL)
+	{
+		UE_LOG(LogPolyVox, Warning, TEXT("Tried to set voxel (%d, %d, %d) through a resident-only accessor, but its chunk isn't resident."), XPos, YPos, ZPos);
+		return;
+	}
+	Volume->SetVoxelInChunk(chunk, chunkPos, FIntVector(XPos & chunkMask, YPos & chunkMask, ZPos & chunkMask), Voxel);
+}
+
+FPagedChunkData* FVolumeAccessor::FillCacheEntry(FCacheEntry& Entry, int32 ChunkX, int32 ChunkY, int32 ChunkZ)
+{
+	CacheMisses++;
+	if (Entry.Chunk != NULL)
+	{
+		Volume->UnpinChunk(Entry.Chunk);
+	}
+	Entry.Chunk = bResidentOnly ? Volume->GetPinnedChunkIfResident(ChunkX, ChunkY, ChunkZ) : Volume->GetPinnedChunk(ChunkX, ChunkY, ChunkZ);
+	Entry.bIsFilled = true;
+	Entry.X = ChunkX;
+	Entry.Y = ChunkY;
+	Entry.Z = ChunkZ;
+	return Entry.Chunk;
+}
+
+void FVolumeAccessor::CopyCache(const FVolumeAccessor& Other)
+{
+	FMemory::Memcpy(Cache, Other.Cache, sizeof(Cache));
+	for (int32 i = 0; i < CACHE_SIZE; i++)
+	{
+		if (Cache[i].Chunk != NULL)
+		{
+			// Both of us will unpin it later
+			Volume->PinChunk(Cache[i].Chunk);
+		}
+	}
+	CacheHits = 0;
+	CacheMisses = 0;
+}
+
+void FVolumeAccessor::FlushCounters()
+{
+	// Fold our counters into the volume's, so they show up in its stats
+	Volume->ChunkCacheHits.Add(CacheHits);
+	Volume->ChunkCacheMisses.Add(CacheMisses);
+	CacheHits = 0;
+	CacheMisses = 0;
+}
+
+void FVolumeAccessor::Reset()
+{
+	for (int32 i = 0; i < CACHE_SIZE; i++)
+	{
+		if (Cache[i].Chunk != NULL)
+		{
+			Volume->UnpinChunk(Cache[i].Chunk);
+			Cache[i].Chunk = NULL;
+		}
+		Cache[i].bIsFilled = false;
+	}
+}
+
+UPagedVolumeComponent* FVolumeAccessor::GetVolume() const
+{
+	return Volume;
+}
+
+bool FVolumeAccessor::IsResidentOnly() const
+{
+	return bResidentOnly;
+}
+
+int32 FVolumeAccessor::GetCacheHits() const
+{
+	return CacheHits;
+}
+
+int32 FVolumeAccessor::GetCacheMisses() const
+{
+	return CacheMisses;
+}
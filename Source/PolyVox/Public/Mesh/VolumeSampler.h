@@ -27,19 +27,91 @@ SOFTWARE.
 
 #include "RegionHelper.h"
 
+#include "Paging/VolumeAccessor.h"
+#include "Paging/PalettedVoxelStorage.h"
+
 class UPagedVolumeComponent;
-class APagedChunk;
+class FPagedChunkData;
+class FPalettedVoxelStorage;
+
+// What a sampler does when it reaches a chunk which isn't resident.
+enum class ESamplerBorderPolicy : uint8
+{
+	// Page the chunk in, like any other read from the volume.
+	PageIn,
+	// Read the sampler's border voxel instead.
+	BorderVoxel,
+	// Read the nearest voxel of the last resident chunk the sampler was in, so the data looks like it carries on past
+	// the edge. Until the sampler has been in a resident chunk this reads the border voxel.
+	Clamp,
+	// Read the border voxel, but only as a placeholder: the caller is expected to check IsResident() (or
+	// GetNonResidentReads() afterwards) and treat those voxels as unknown.
+	NotResident
+};
 
 /**
- * 
+ * Walks through the voxels of a volume one step at a time, which is much cheaper than looking each one up.
  */
 class UVolumeSampler
 {
 public:
 	UVolumeSampler(UPagedVolumeComponent* VolumeData);
+	// Samplers with any border policy other than PageIn are read-only: they never page chunks in or change which
+	// chunks the volume holds, so what they read is limited to what is already in memory.
+	UVolumeSampler(UPagedVolumeComponent* VolumeData, ESamplerBorderPolicy Policy, FVoxel Border = FVoxel::GetEmptyVoxel());
 	UVolumeSampler(const UVolumeSampler& Sampler);
 
-	FVoxel GetVoxel();
+	// Inside a resident chunk this reads straight from the chunk's storage. The index is kept in range by
+	// SetPosition() and the Move functions, and the chunk is pinned, so it is only checked in slow-check builds.
+	FORCEINLINE FVoxel GetVoxel()
+	{
+		if (CurrentVoxels != NULL)
+		{
+			return CurrentVoxels->GetUnchecked(CurrentVoxelIndex);
+		}
+		return GetVoxelOutsideChunk();
+	}
+	// Whether the voxel at the current position is in a resident chunk, and so GetVoxel() reads real data.
+	// This is always true for samplers which page chunks in.
+	bool IsResident() const;
+	// How many times this sampler has read a voxel from a chunk which wasn't resident. Copies start again from zero.
+	int32 GetNonResidentReads() const;
+	ESamplerBorderPolicy GetBorderPolicy() const;
+
+	// Reads one of the 26 voxels around the current position without moving the sampler. The name gives the offset
+	// on each axis: 1n is one step negative, 0p is no step and 1p is one step positive. Inside the current chunk this
+	// is a single index offset; at the chunk's edge the neighbouring chunk comes from the accessor's cache.
+	// PeekVoxel0px0py0pz() is the current voxel, the same as GetVoxel().
+	FVoxel PeekVoxel1nx1ny1nz();
+	FVoxel PeekVoxel1nx1ny0pz();
+	FVoxel PeekVoxel1nx1ny1pz();
+	FVoxel PeekVoxel1nx0py1nz();
+	FVoxel PeekVoxel1nx0py0pz();
+	FVoxel PeekVoxel1nx0py1pz();
+	FVoxel PeekVoxel1nx1py1nz();
+	FVoxel PeekVoxel1nx1py0pz();
+	FVoxel PeekVoxel1nx1py1pz();
+
+	FVoxel PeekVoxel0px1ny1nz();
+	FVoxel PeekVoxel0px1ny0pz();
+	FVoxel PeekVoxel0px1ny1pz();
+	FVoxel PeekVoxel0px0py1nz();
+	FVoxel PeekVoxel0px0py0pz();
+	FVoxel PeekVoxel0px0py1pz();
+	FVoxel PeekVoxel0px1py1nz();
+	FVoxel PeekVoxel0px1py0pz();
+	FVoxel PeekVoxel0px1py1pz();
+
+	FVoxel PeekVoxel1px1ny1nz();
+	FVoxel PeekVoxel1px1ny0pz();
+	FVoxel PeekVoxel1px1ny1pz();
+	FVoxel PeekVoxel1px0py1nz();
+	FVoxel PeekVoxel1px0py0pz();
+	FVoxel PeekVoxel1px0py1pz();
+	FVoxel PeekVoxel1px1py1nz();
+	FVoxel PeekVoxel1px1py0pz();
+	FVoxel PeekVoxel1px1py1pz();
+
 	void SetPosition(int32 XPos, int32 YPos, int32 ZPos);
 	void MoveNegativeX();
 	void MovePositiveX();
@@ -49,7 +121,19 @@ public:
 	void MovePositiveZ();
 
 private:
+	// GetVoxel() when the sampler isn't in a resident chunk.
+	FVoxel GetVoxelOutsideChunk();
+	// GetVoxel() for positions in chunks which aren't resident, following the border policy.
+	FVoxel GetNonResidentVoxel(int32 XPos, int32 YPos, int32 ZPos);
+	// Does the work for the PeekVoxel functions. Each offset is -1, 0 or 1.
+	template <int32 XOffset, int32 YOffset, int32 ZOffset>
+	FVoxel PeekVoxel();
+	// Reads a voxel near the current position from whichever chunk it is in.
+	FVoxel PeekVoxelInOtherChunk(int32 XOffset, int32 YOffset, int32 ZOffset);
+
 	UPagedVolumeComponent* Volume;
+	// Keeps CurrentChunk pinned, so samplers can be used off the game thread
+	FVolumeAccessor Accessor;
 
 	//The current position in the volume
 	int32 XPosInVolume;
@@ -57,11 +141,20 @@ private:
 	int32 ZPosInVolume;
 
 	int32 CurrentVoxelIndex;
-	APagedChunk* CurrentChunk;
+	FPagedChunkData* CurrentChunk;
+	// CurrentChunk's voxel storage, which GetVoxel() reads from directly. This is NULL whenever CurrentChunk is.
+	const FPalettedVoxelStorage* CurrentVoxels;
 
 	int32 XPosInChunk;
 	int32 YPosInChunk;
 	int32 ZPosInChunk;
 
 	uint16 ChunkSideLengthMinusOne;
+
+	ESamplerBorderPolicy BorderPolicy;
+	FVoxel BorderVoxel;
+	int32 NonResidentReads;
+	// The last resident chunk the sampler was in, which the Clamp policy reads from.
+	bool bHasClampChunk;
+	FIntVector ClampChunkPosition;
 };
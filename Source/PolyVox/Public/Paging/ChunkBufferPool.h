@@ -0,0 +1,73 @@
+/*******************************************************************************
+The MIT License (MIT)
+
+Copyright (c) 2017 Jay Stevens
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*******************************************************************************/
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Misc/ScopeLock.h"
+
+/**
+ * Recycles the packed word buffers used by chunk voxel storage.
+ *
+ * Chunks are paged in and out constantly as the player moves around, and every chunk of a volume asks for buffers
+ * of the same handful of sizes. Rather than handing those back to the general purpose allocator (and fragmenting it
+ * over a long session), released buffers are kept on a free list per size and handed out again.
+ *
+ * Buffers are zeroed when they are handed out. This is safe to use from multiple threads.
+ */
+class POLYVOX_API FChunkBufferPool
+{
+public:
+	FChunkBufferPool(int32 MaxFreeBuffersPerSize = 64);
+	~FChunkBufferPool();
+
+	// Fills OutBuffer with NumWords zeroed words, reusing a released buffer of that size if there is one.
+	// Anything OutBuffer already held is released first.
+	void Acquire(int32 NumWords, TArray<uint64>& OutBuffer);
+	// Takes a buffer back, leaving the array empty.
+	void Release(TArray<uint64>& Buffer);
+	// Frees every buffer sitting on the free lists.
+	void Empty();
+
+	// How many requests were served from the free lists.
+	int32 GetHits() const;
+	// How many requests needed a fresh allocation.
+	int32 GetMisses() const;
+	// The most bytes that have been handed out at once.
+	int64 GetHighWaterBytes() const;
+	// How many bytes are currently sitting on the free lists.
+	int64 GetPooledBytes() const;
+
+private:
+	mutable FCriticalSection PoolLock;
+	// Free buffers, keyed by their size in words
+	TMap<int32, TArray<TArray<uint64>>> FreeBuffers;
+	int32 MaxFreeBuffersPerSize;
+
+	int32 Hits;
+	int32 Misses;
+	int64 OutstandingBytes;
+	int64 HighWaterBytes;
+	int64 PooledBytes;
+};
@@ -0,0 +1,76 @@
+/*******************************************************************************
+The MIT License (MIT)
+
+Copyright (c) 2017 Jay Stevens
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*******************************************************************************/
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class FPagedChunkData;
+
+/**
+ * Maps chunk-space positions to the chunks resident in a volume.
+ *
+ * This is an open addressing hash table with linear probing. Positions are packed into a single 64-bit key (21 bits
+ * per axis, so chunk coordinates must be within +/- 2^20) and mixed before probing, so that nearby and negative
+ * positions spread out over the whole table. Removal shifts later entries back rather than leaving tombstones, so
+ * a lookup for a chunk which isn't resident stops at the first empty slot. The table doubles whenever it would
+ * become more than half full.
+ */
+class POLYVOX_API FChunkHashTable
+{
+public:
+	FChunkHashTable(int32 InitialCapacity = 1024);
+
+	// Forgets every chunk (without deleting them) and shrinks the table back down to the given capacity.
+	void Empty(int32 InitialCapacity = 1024);
+
+	// Returns the chunk at a position, or NULL if it isn't in the table.
+	FPagedChunkData* Find(int32 ChunkX, int32 ChunkY, int32 ChunkZ) const;
+	// Adds a chunk under its chunk-space position, which must not already be in the table.
+	void Add(FPagedChunkData* Chunk);
+	// Takes a chunk out of the table and returns it, or NULL if there was nothing at that position.
+	FPagedChunkData* Remove(int32 ChunkX, int32 ChunkY, int32 ChunkZ);
+
+	int32 Num() const;
+
+	// The table can be walked slot by slot. Slots may be empty (NULL), and adding or removing chunks moves
+	// other chunks between slots, so don't hold on to slot indices across changes.
+	int32 GetCapacity() const;
+	FPagedChunkData* GetAtSlot(int32 Slot) const;
+
+	static uint64 PackKey(int32 ChunkX, int32 ChunkY, int32 ChunkZ);
+
+private:
+	static uint64 HashKey(uint64 Key);
+	// Returns the slot holding the key, or INDEX_NONE.
+	int32 FindSlot(uint64 Key) const;
+	void Insert(uint64 Key, FPagedChunkData* Chunk);
+	void Grow();
+
+	TArray<uint64> Keys;
+	// NULL marks an empty slot.
+	TArray<FPagedChunkData*> Chunks;
+	int32 Count;
+	uint32 SlotMask;
+};
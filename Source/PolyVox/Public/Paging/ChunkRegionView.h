@@ -0,0 +1,78 @@
+/*******************************************************************************
+The MIT License (MIT)
+
+Copyright (c) 2017 Jay Stevens
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*******************************************************************************/
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Voxel.h"
+
+class FPagedChunkData;
+
+/**
+ * The part of a single chunk which lies inside a region, handed out by UPagedVolumeComponent::VisitRegion().
+ *
+ * Coordinates are in chunk space, so there is no chunk lookup or shifting and masking per voxel. Writes go straight
+ * to the chunk's storage; the view remembers the box around them, and once the visitor is done with the chunk the
+ * volume rebuilds its solidity and marks the box dirty (queueing mesh updates), rather than doing so for every voxel.
+ */
+class POLYVOX_API FChunkRegionView
+{
+public:
+	FChunkRegionView(FPagedChunkData* ViewedChunk, const FIntVector& ChunkOrigin, const FIntVector& LowerBound, const FIntVector& UpperBound);
+
+	// The world space position of the chunk's first voxel. Add this to chunk space coordinates to get world coordinates.
+	const FIntVector& GetChunkOrigin() const;
+	// The part of the region inside this chunk, in chunk space. Both bounds are inclusive.
+	const FIntVector& GetLower() const;
+	const FIntVector& GetUpper() const;
+	// Whether the region covers every voxel of the chunk.
+	bool CoversWholeChunk() const;
+
+	// Whether every voxel in the chunk (not just the view) has the same value. Lets visitors skip air and rock.
+	bool IsUniform() const;
+	FVoxel GetUniformVoxel() const;
+
+	FVoxel GetVoxel(int32 XPos, int32 YPos, int32 ZPos) const;
+	// Writing a voxel its current value does nothing, and doesn't count as an edit.
+	void SetVoxel(int32 XPos, int32 YPos, int32 ZPos, FVoxel Voxel);
+	// Sets every voxel in the view. If the view covers the whole chunk, the chunk just becomes uniform.
+	void Fill(FVoxel Voxel);
+
+	// Whether anything has been written through this view, and the box around the writes.
+	bool WasModified() const;
+	const FIntVector& GetModifiedLower() const;
+	const FIntVector& GetModifiedUpper() const;
+
+private:
+	void GrowModifiedRegion(const FIntVector& NewLower, const FIntVector& NewUpper);
+
+	FPagedChunkData* Chunk;
+	FIntVector Origin;
+	FIntVector Lower;
+	FIntVector Upper;
+
+	bool bModified;
+	FIntVector ModifiedLower;
+	FIntVector ModifiedUpper;
+};
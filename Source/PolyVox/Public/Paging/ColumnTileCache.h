@@ -0,0 +1,107 @@
+/*******************************************************************************
+The MIT License (MIT)
+
+Copyright (c) 2017 Jay Stevens
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*******************************************************************************/
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Misc/ScopeLock.h"
+
+// A summary of one column of terrain, as worked out by a generator.
+struct POLYVOX_API FColumnSample
+{
+	// The height of the surface. What this means is up to the generator; UInfiniteNoisePager keeps its raw noise value.
+	float Height;
+	// The material of the topmost solid voxel.
+	uint8 Material;
+	uint8 Biome;
+};
+
+// The columns running through a chunk-sized footprint, in X-major order (index = x + y * chunk side length).
+struct POLYVOX_API FColumnTile
+{
+	TArray<FColumnSample> Columns;
+};
+
+typedef TSharedPtr<const FColumnTile, ESPMode::ThreadSafe> FColumnTilePtr;
+
+/**
+ * Remembers the 2D column data generators work out for each chunk footprint, so that a stack of chunks at the same
+ * X and Y only has to work it out once.
+ *
+ * Heightmap generators spend most of their time on 2D noise, and every chunk in a vertical stack asks for exactly the
+ * same columns. Tiles are keyed by the chunk-space X and Y of the footprint along with the seed they were made with.
+ * The cache holds a fixed number of tiles, dropping the least recently used when it is full. Anything else a tile
+ * depends on (noise settings, for example) isn't part of the key, so the owner should call Empty() when it changes.
+ *
+ * Tiles are handed out as shared pointers, so they stay valid after being dropped. This is safe to use from multiple
+ * threads.
+ */
+class POLYVOX_API FColumnTileCache
+{
+public:
+	FColumnTileCache(int32 MaxTiles = 1024);
+
+	// Changes how many tiles the cache holds, dropping the least recently used if it is over.
+	void SetMaxTiles(int32 MaxTiles);
+	// Returns the tile for a footprint, or an invalid pointer if it isn't cached. The tile becomes the most recently used.
+	FColumnTilePtr Find(int32 ChunkX, int32 ChunkY, int32 Seed);
+	// Caches a tile, replacing anything already there for that footprint and seed.
+	void Add(int32 ChunkX, int32 ChunkY, int32 Seed, const FColumnTilePtr& Tile);
+	// Drops every tile. Call this whenever anything which went into the tiles (other than the seed) changes.
+	void Empty();
+
+	// How many Find() calls found a tile.
+	int32 GetHits() const;
+	// How many Find() calls didn't.
+	int32 GetMisses() const;
+	int32 Num() const;
+
+private:
+	struct FTileSlot
+	{
+		FIntVector Key;
+		FColumnTilePtr Tile;
+		// Neighbours in the recently used list, by slot index
+		int32 MoreRecentlyUsed;
+		int32 LessRecentlyUsed;
+	};
+
+	// Recently used list upkeep. These must be called with CacheLock held.
+	// MarkUsed moves a slot to the front of the list, adding it if it wasn't there.
+	void MarkUsed(int32 Slot);
+	void Unlink(int32 Slot);
+	void DropLeastRecentlyUsed();
+
+	mutable FCriticalSection CacheLock;
+	// Slots are reused rather than removed, so indices stay put. Dropped slots are on FreeSlots.
+	TArray<FTileSlot> Slots;
+	TArray<int32> FreeSlots;
+	TMap<FIntVector, int32> SlotsByKey;
+	int32 MostRecentlyUsedSlot;
+	int32 LeastRecentlyUsedSlot;
+	int32 MaxTiles;
+
+	int32 Hits;
+	int32 Misses;
+};
@@ -0,0 +1,103 @@
+/*******************************************************************************
+The MIT License (MIT)
+
+Copyright (c) 2017 Jay Stevens
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*******************************************************************************/
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Misc/ScopeLock.h"
+
+/**
+ * Keeps the voxels of recently evicted chunks around in compressed form, so that a chunk which is needed again soon
+ * after being thrown out can be decompressed rather than paged in from scratch.
+ *
+ * This sits between a volume's resident chunks and its pager. Chunks are stored in the run-length encoded form
+ * FPagedChunkData::SerializeVoxels() writes, which is usually a small fraction of the size of the chunk itself.
+ * Whenever the cache is over its budget, the chunks which were evicted longest ago are dropped first. Taking a chunk
+ * out of the cache removes it, since it is resident again and will be put back when it is next evicted.
+ *
+ * Only chunks whose voxels match what the pager would give back belong in here: either they haven't been modified,
+ * or they have already been paged out. This is safe to use from multiple threads.
+ */
+class POLYVOX_API FCompressedChunkCache
+{
+public:
+	FCompressedChunkCache(int64 BudgetInBytes = 0);
+
+	// Changes how many bytes the cache may hold, dropping the oldest chunks if it is now over budget.
+	// A budget of 0 turns the cache off.
+	void SetBudget(int64 BudgetInBytes);
+	// Stores a chunk's voxels under its chunk-space position, replacing anything already there. Bytes is left empty.
+	void Add(const FIntVector& Position, TArray<uint8>& Bytes);
+	// If a chunk's voxels are in the cache, moves them into OutBytes and returns true.
+	bool Take(const FIntVector& Position, TArray<uint8>& OutBytes);
+	// Drops a chunk from the cache, if it is there.
+	void Remove(const FIntVector& Position);
+	// Drops every chunk.
+	void Empty();
+
+	// How many Take() calls found the chunk they were after.
+	int32 GetHits() const;
+	// How many Take() calls didn't.
+	int32 GetMisses() const;
+	// How many chunks have been dropped to stay within the budget.
+	int32 GetEvictions() const;
+	// How many bytes the cached chunks are taking up, including a rough allowance for bookkeeping.
+	int64 GetBytes() const;
+	int32 Num() const;
+
+private:
+	struct FCachedChunk
+	{
+		TArray<uint8> Bytes;
+		// Matches the chunk's entry in the eviction order.
+		uint32 Serial;
+	};
+	struct FEvictionOrderEntry
+	{
+		FIntVector Position;
+		uint32 Serial;
+	};
+
+	static int64 GetEntrySize(const FCachedChunk& Entry);
+	// Drops the oldest chunks until the cache is within its budget. Must be called with CacheLock held.
+	void Trim();
+	// Removes the entries at the front of the eviction order which no longer refer to anything. Must be called with
+	// CacheLock held.
+	void SkipStaleEvictionOrderEntries();
+
+	mutable FCriticalSection CacheLock;
+	TMap<FIntVector, FCachedChunk> CachedChunks;
+	// Chunks in the order they were added, oldest first, starting from EvictionOrderHead. A chunk is never touched
+	// while it is in the cache, so this is also least recently used order. Entries are left behind when chunks are
+	// taken out or replaced; they are told apart from live ones by their serial number and skipped over.
+	TArray<FEvictionOrderEntry> EvictionOrder;
+	int32 EvictionOrderHead;
+	uint32 NextSerial;
+
+	int64 BudgetInBytes;
+	int64 CachedBytes;
+	int32 Hits;
+	int32 Misses;
+	int32 Evictions;
+};
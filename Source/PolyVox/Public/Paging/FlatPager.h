@@ -22,6 +22,5 @@ public:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Chunk")
 	uint8 VoxelMaterial;
 
-protected:
-	virtual void PageIn_Implementation(const FRegion& Region, APagedChunk* Chunk) override;
+	virtual void PageIn(const FRegion& Region, FPagedChunkData* Chunk) override;
 };
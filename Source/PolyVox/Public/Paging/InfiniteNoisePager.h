@@ -4,6 +4,7 @@
 
 #include "Paging/Pager.h"
 #include "Noise/PolyVoxNoise.h"
+#include "ColumnTileCache.h"
 #include "InfiniteNoisePager.generated.h"
 
 /**
@@ -47,6 +48,30 @@ public:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Biomes")
 	FVoxelNoiseSettings BiomeSelectorNoiseSettings;
 
-protected:
-	virtual void PageIn_Implementation(const FRegion& Region, APagedChunk* Chunk) override;
+	// How many chunk footprints' worth of columns to remember, so that chunks stacked on top of each other don't all
+	// work out the same noise. Each one takes 8 bytes per column, so 8KB for 32x32 chunks.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Biomes")
+	int32 ColumnTileCacheSize;
+
+	// Forgets every remembered column. Call this after changing any of the settings above while chunks are being paged in.
+	UFUNCTION(BlueprintCallable, Category = "Biomes")
+	void InvalidateColumnCache();
+
+#if WITH_EDITOR
+	virtual void PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent) override;
+#endif
+
+	virtual void PageIn(const FRegion& Region, FPagedChunkData* Chunk) override;
+	virtual void PageInBatch(const TArray<FPagedChunkData*>& Chunks) override;
+
+private:
+	// Noise generators which have already been set up, by seed (X) and biome (Y).
+	typedef TMap<FIntPoint, TUniquePtr<PolyVoxNoise>> FNoiseGeneratorMap;
+
+	// Fills a chunk with terrain, reusing and adding to the given noise generators.
+	void FillChunk(const FRegion& Region, FPagedChunkData* Chunk, FNoiseGeneratorMap& NoiseGenerators);
+	// Returns the columns running through a chunk, working them out if they aren't in the cache.
+	FColumnTilePtr GetColumnTile(const FRegion& Region, FPagedChunkData* Chunk, FNoiseGeneratorMap& NoiseGenerators);
+
+	FColumnTileCache ColumnTiles;
 };
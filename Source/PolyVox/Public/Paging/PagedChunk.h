@@ -25,80 +25,42 @@ SOFTWARE.
 
 #pragma once
 
-#include "UObject/NoExportTypes.h"
+#include "GameFramework/Actor.h"
 #include "RegionHelper.h"
-#include "Pager.h"
 #include "PagedVolumeComponent.h"
 #include "Mesh/VoxelProceduralMeshComponent.h"
 #include "PagedChunk.generated.h"
 
 /**
- * 
+ * Displays the mesh for a single chunk of a UPagedVolumeComponent.
+ * The voxels themselves live in an FPagedChunkData owned by the volume; these actors are only spawned
+ * for chunks which actually produce triangles.
  */
 UCLASS(BlueprintType)
 class POLYVOX_API APagedChunk : public AActor
 {
-	friend class UPagedVolumeComponent;
 	GENERATED_BODY()
 public:
 	APagedChunk();
-	~APagedChunk();
 
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Mesh")
 	UVoxelProceduralMeshComponent* VoxelMesh;
 	UPROPERTY(VisibleInstanceOnly, BlueprintReadOnly, Category = "Voxels")
 	FRegion ChunkRegion;
-	UPROPERTY(VisibleInstanceOnly, BlueprintReadOnly, Category = "Voxels")
-	bool bDueToBePagedOut;
-
-	UFUNCTION(BlueprintCallable, Category = "Chunk|Voxels")
-	void InitChunk(FVector Position, uint8 ChunkSideLength, UPager* VoxelPager = nullptr, float VoxelSize = 100.0f, int32 Seed = 123);
 
 	UFUNCTION(BlueprintCallable, Category = "Chunk|Voxels")
-	void RemoveChunk();
-
-	UFUNCTION(BlueprintPure, Category="Chunk|Voxels")
-	TArray<FVoxel> GetData() const;
-	UFUNCTION(BlueprintPure, Category = "Chunk|Size")
-	int32 GetDataSizeInBytes() const;
-
-	UFUNCTION(BlueprintPure, Category = "Chunk|Voxels")
-	FVoxel GetVoxelByCoordinatesWorldSpace(int32 XPos, int32 YPos, int32 ZPos);
-	UFUNCTION(BlueprintPure, Category = "Chunk|Voxels")
-	FVoxel GetVoxelByCoordinatesChunkSpace(int32 XPos, int32 YPos, int32 ZPos);
-
-	UFUNCTION(BlueprintCallable, Category = "Chunk|Voxels")
-	void SetVoxelByCoordinatesWorldSpace(int32 XPos, int32 YPos, int32 ZPos, FVoxel Value);
-	UFUNCTION(BlueprintCallable, Category = "Chunk|Voxels")
-	void SetVoxelByCoordinatesChunkSpace(int32 XPos, int32 YPos, int32 ZPos, FVoxel Value);
+	void InitChunk(FRegion Region, float VoxelSize = 100.0f);
 
 	UFUNCTION(BlueprintCallable, Category = "Volume|Mesh")
 	void CreateMarchingCubesMesh(UPagedVolumeComponent* Volume, TArray<FVoxelMaterial> VoxelMaterials);
-	
-	FVoxel GetDataAtIndex(const int32 CurrentVoxelIndex) const;
-
-	UPROPERTY(VisibleInstanceOnly, BlueprintReadOnly, Category = "Random")
-	int32 RandomSeed;
-
-private:
-	static int32 CalculateSizeInBytes(uint8 ChunkSideLength);
-
-	// This is so we can tell whether a uncompressed chunk has to be recompressed and whether
-	// a compressed chunk has to be paged back to disk, or whether they can just be discarded.
-	UPROPERTY()
-	bool bDataModified;
-	UPROPERTY()
-	bool bNeedsNewMarchingCubesMesh;
 
-	UPROPERTY()
-	TArray<FVoxel> VoxelData;
-	UPROPERTY()
-	uint8 SideLength;
-	UPROPERTY()
-	uint8 SideLengthPower;
-	UPROPERTY()
-	UPager* Pager;
+	// Stitches the mesh blocks back together and hands the result to the mesh component.
+	void UpdateMeshFromBlocks(const TArray<FVoxelMaterial>& VoxelMaterials);
 
-	UPROPERTY()
-	FVector ChunkSpacePosition;
+	// The chunk's mesh is extracted in blocks (see UPagedVolumeComponent::GetMeshBlockSideLengthPower()) so that an
+	// edit only has to extract the blocks around it again. Indexed by x + y * blocks per side + z * blocks per side^2;
+	// each block has one section per material, like the output of ExtractMarchingCubesMesh().
+	TArray<TArray<FVoxelMeshSection>> MeshBlocks;
+	// The edit version of the chunk data when the mesh was last updated.
+	uint32 MeshEditVersion = 0;
 };
@@ -0,0 +1,231 @@
+/*******************************************************************************
+The MIT License (MIT)
+
+Copyright (c) 2015 David Williams and Matthew Williams
+Modified for use in Unreal Engine 4 by Jay Stevens
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*******************************************************************************/
+
+#pragma once
+
+#include "RegionHelper.h"
+#include "PalettedVoxelStorage.h"
+#include "UObject/WeakObjectPtr.h"
+#include "Misc/ScopeLock.h"
+
+class UPager;
+class FChunkBufferPool;
+class APagedChunk;
+
+// What an 8x8x8 brick of a chunk contains, as far as solidity goes.
+enum class EBrickOccupancy : uint8
+{
+	Mixed,
+	AllAir,
+	AllSolid
+};
+
+/**
+ * The voxel data for a single chunk of a UPagedVolumeComponent.
+ *
+ * This is deliberately not a UObject: a volume can hold tens of thousands of chunks, and most of them are solid
+ * underground or empty sky which never produce any triangles. Keeping them as plain data means paging a chunk in
+ * doesn't spawn anything or give the garbage collector more to scan. An APagedChunk actor is only spawned for chunks
+ * which actually have a mesh to display.
+ */
+class POLYVOX_API FPagedChunkData
+{
+	friend class UPagedVolumeComponent;
+	friend class FVolumeAccessor;
+	friend class FChunkRegionView;
+	friend class UVolumeSampler;
+public:
+	FPagedChunkData();
+	~FPagedChunkData();
+
+	// Buffers for the voxel data will come from the given pool, if there is one. If SavedVoxels is given, the voxels
+	// are read from that (as written by SerializeVoxels()) instead of being paged in, unless it turns out to be malformed.
+	void InitChunk(const FIntVector& Position, uint8 ChunkSideLength, UPager* VoxelPager = nullptr, int32 Seed = 123, FChunkBufferPool* Pool = nullptr, const TArray<uint8>* SavedVoxels = nullptr);
+	// Pages the chunk out (if it has been modified) and frees its data.
+	void RemoveChunk();
+	// Whether the chunk has changed since it was paged in, and so needs paging out before it is thrown away.
+	bool IsModified() const;
+
+	// How much memory this chunk's voxels are currently taking up.
+	int32 GetDataSizeInBytes() const;
+
+	FVoxel GetVoxelByCoordinatesWorldSpace(int32 XPos, int32 YPos, int32 ZPos) const;
+	FVoxel GetVoxelByCoordinatesChunkSpace(int32 XPos, int32 YPos, int32 ZPos) const;
+
+	void SetVoxelByCoordinatesWorldSpace(int32 XPos, int32 YPos, int32 ZPos, FVoxel Value);
+	void SetVoxelByCoordinatesChunkSpace(int32 XPos, int32 YPos, int32 ZPos, FVoxel Value);
+
+	FVoxel GetDataAtIndex(const int32 CurrentVoxelIndex) const;
+	// Sets a voxel by its index in storage, which is the same Morton order GetDataAtIndex() uses. This only touches
+	// the voxel storage, so it is meant for pagers filling a chunk in PageIn.
+	void SetDataAtIndex(const int32 CurrentVoxelIndex, FVoxel Value);
+	int32 GetVoxelCount() const;
+
+	// Sets every voxel in the chunk to a single value without touching them one at a time.
+	// Pagers should call this from PageIn when they know a chunk is all air or all one material.
+	void SetUniform(FVoxel Value);
+	// Sets every voxel between two chunk space heights (inclusive) to a single value, a whole word of voxels at a time.
+	// Heights outside the chunk are clamped, so a slab covering the entire chunk just makes it uniform.
+	void FillSlab(int32 LowerZ, int32 UpperZ, FVoxel Value);
+	// Replaces every voxel with the contents of a dense buffer in X-major order (index = x + y * SideLength +
+	// z * SideLength^2), which is how most generators produce them. The voxels are reordered into storage order here.
+	void CopyFromLinear(const TArray<FVoxel>& Voxels);
+	// Copies every voxel out into a dense buffer in the same X-major order CopyFromLinear() takes.
+	void CopyToLinear(TArray<FVoxel>& OutVoxels) const;
+	// Whether every voxel in the chunk has the same value. Uniform chunks don't store any per-voxel data.
+	bool IsUniform() const;
+	// The value shared by every voxel in a uniform chunk. Only meaningful if IsUniform() is true.
+	FVoxel GetUniformVoxel() const;
+
+	// Run-length encodes the voxels in place, freeing the uncompressed data. The volume does this to chunks which
+	// haven't been touched in a while; UPagedVolumeComponent::GetChunk() decompresses them again transparently.
+	// Returns false (and leaves the chunk alone) if the voxels are too noisy for compression to save anything.
+	bool Compress();
+	void Decompress();
+	bool IsCompressed() const;
+
+	// Writes the voxels out in the same compact form Compress() uses, for pagers which save chunks somewhere.
+	// This works whether or not the chunk is currently compressed.
+	void SerializeVoxels(TArray<uint8>& OutBytes) const;
+	// Replaces the voxels with data written by SerializeVoxels(). This is meant to be called from PageIn.
+	// Returns false (leaving the chunk as empty air) if the data is malformed or was saved from a different size of chunk.
+	bool DeserializeVoxels(const TArray<uint8>& Bytes);
+
+	// Returns the solidity of Count (at most 64) voxels in a row along X, starting at the given chunk space position.
+	// Bit 0 is the voxel at XPos. This lets callers test many voxels at once instead of fetching each FVoxel.
+	uint64 GetSolidityBitsAlongX(int32 XPos, int32 YPos, int32 ZPos, int32 Count) const;
+	// The raw solidity plane: one bit per voxel, in X-major linear order (bit index = x + y * SideLength + z * SideLength^2).
+	// This is empty for uniform chunks, where every voxel's solidity is GetUniformVoxel().bIsSolid.
+	const TArray<uint64>& GetSolidityWords() const;
+
+	// Occupancy summary. Chunks are split into bricks of 8x8x8 voxels (or the whole chunk, for chunks smaller than
+	// that) and each brick knows whether it is all air, all solid, or has a solid/air transition somewhere inside it.
+	static const uint8 BRICK_SIDE_LENGTH_POWER = 3;
+	uint8 GetBrickSideLengthPower() const;
+	EBrickOccupancy GetBrickOccupancy(int32 BrickX, int32 BrickY, int32 BrickZ) const;
+	// One bit per brick (index = x + y * bricks per side + z * bricks per side^2), set if the brick is mixed.
+	const TArray<uint64>& GetMixedBrickMask() const;
+	bool IsAllAir() const;
+	bool IsAllSolid() const;
+
+	// Mesh invalidation. The chunk tracks a box around every voxel changed since its mesh was last built, in chunk
+	// space with inclusive bounds. The box may reach SideLength on any axis: a chunk's mesh also reads the first layer
+	// of voxels from its positive neighbours, so edits there dirty this chunk too (see UPagedVolumeComponent).
+	// MarkDirty returns true if the chunk's mesh was up to date beforehand. These are safe to call from any thread,
+	// and do nothing while the chunk is being paged in.
+	bool MarkDirty(const FIntVector& Lower, const FIntVector& Upper);
+	void MarkAllDirty();
+	bool NeedsNewMarchingCubesMesh() const;
+	bool GetDirtyRegion(FIntVector& OutLower, FIntVector& OutUpper) const;
+	void ClearDirtyRegion();
+	// Incremented every time the chunk is dirtied, so a mesh can tell which edits it has seen.
+	uint32 GetEditVersion() const;
+
+	const FIntVector& GetChunkSpacePosition() const;
+	// The actor displaying this chunk's mesh, if it has been given one.
+	APagedChunk* GetMeshActor() const;
+
+	static int32 CalculateSizeInBytes(uint8 ChunkSideLength);
+
+	FRegion ChunkRegion;
+	int32 RandomSeed;
+
+private:
+	// This is so we can tell whether a uncompressed chunk has to be recompressed and whether
+	// a compressed chunk has to be paged back to disk, or whether they can just be discarded.
+	bool bDataModified;
+	bool bNeedsNewMarchingCubesMesh;
+	bool bIsCompressed;
+	// Set once a mesh has been asked for, so that the volume knows to queue a new one after an edit.
+	bool bWantsMesh;
+	// Set between PrepareForPageIn() and FinishPageIn(). The pager owns the chunk then and FinishPageIn() dirties all
+	// of it anyway, so the pager's writes skip the dirty region bookkeeping and its lock.
+	bool bIsPagingIn;
+	// Only meaningful if bNeedsNewMarchingCubesMesh is set.
+	FIntVector DirtyLower;
+	FIntVector DirtyUpper;
+	uint32 EditVersion;
+	// Neighbours can be dirtied by edits on other threads.
+	mutable FCriticalSection DirtyRegionLock;
+	// How many accessors are holding on to this chunk. Pinned chunks are never compressed or evicted.
+	FThreadSafeCounter PinCount;
+	// The volume tick this chunk was last fetched on, used to find cold chunks.
+	uint32 LastAccessTick;
+	// The volume's list of resident chunks, most recently used first, which it evicts from the back of.
+	FPagedChunkData* LessRecentlyUsed;
+	FPagedChunkData* MoreRecentlyUsed;
+
+	// Frees everything without giving the pager a chance to save it.
+	void FreeData();
+	// InitChunk() in two halves, for the volume to page in several chunks with one call to the pager. The first sets
+	// the chunk up as empty air, ready to be filled; the second gets it ready for use once it has been.
+	bool PrepareForPageIn(const FIntVector& Position, uint8 ChunkSideLength, UPager* VoxelPager, int32 Seed, FChunkBufferPool* Pool);
+	void FinishPageIn();
+	// Does the work for SetVoxelByCoordinatesChunkSpace. Returns false if the voxel already had that value; otherwise
+	// bOutBecameDirty says whether this was the edit which made the chunk need a new mesh.
+	bool SetVoxel(int32 XPos, int32 YPos, int32 ZPos, FVoxel Value, bool& bOutBecameDirty);
+	// Changes a voxel and keeps the solidity plane up to date, but leaves marking the mesh dirty to the caller.
+	// Returns false if the voxel already had that value.
+	bool WriteVoxel(int32 XPos, int32 YPos, int32 ZPos, FVoxel Value);
+	// SetUniform() without marking the mesh dirty.
+	void WriteUniform(FVoxel Value);
+	// Called after voxels have been written through an FChunkRegionView, which leaves the solidity plane alone.
+	void FinishBulkWrite();
+	// Rebuilds the solidity plane and occupancy summary from the voxel data.
+	void RebuildSolidity();
+	// Rebuilds just the occupancy summary, for bulk writes which have filled in the solidity plane themselves.
+	void RebuildBrickOccupancy();
+	// Gives the chunk an all-air solidity plane.
+	void AllocateSolidity();
+	// Sets or clears a range of bits in the solidity plane, from First up to (but not including) End.
+	void SetSolidityBits(uint32 First, uint32 End, bool bIsSolid);
+	void FreeSolidity();
+	// Adjusts the occupancy summary for a single voxel changing solidity.
+	void UpdateBrickOccupancy(int32 XPos, int32 YPos, int32 ZPos, bool bIsSolid);
+
+	// The "material plane"; this holds full voxels, Morton ordered and palette compressed.
+	FPalettedVoxelStorage VoxelData;
+	// The solidity plane. This duplicates the bIsSolid part of VoxelData in a layout which can be tested
+	// 64 voxels at a time. It is rebuilt rather than stored when the chunk is compressed.
+	TArray<uint64> SolidityWords;
+	// The number of solid voxels in each brick, which the mixed brick mask is derived from.
+	TArray<uint16> BrickSolidCounts;
+	TArray<uint64> MixedBrickMask;
+	int32 SolidVoxelCount;
+	// Set when voxels have been written without updating the solidity plane, so FinishPageIn() knows to rebuild it.
+	bool bSolidityStale;
+	uint8 BrickSideLengthPower;
+	uint8 BricksPerSidePower;
+	TArray<uint8> CompressedData;
+	uint8 SideLength;
+	uint8 SideLengthPower;
+	UPager* Pager;
+	FChunkBufferPool* BufferPool;
+
+	FIntVector ChunkSpacePosition;
+
+	// Spawned actors are kept alive by their level, so a weak pointer is all we need here.
+	TWeakObjectPtr<APagedChunk> MeshActor;
+};
@@ -28,15 +28,108 @@ SOFTWARE.
 #include "Components/ActorComponent.h"
 #include "Pager.h"
 #include "Containers/Queue.h"
+#include "ChunkBufferPool.h"
+#include "CompressedChunkCache.h"
+#include "ChunkHashTable.h"
+#include "PagedChunkData.h"
+#include "VolumeAccessor.h"
+#include "ChunkRegionView.h"
 #include "PagedVolumeComponent.generated.h"
 
 class APagedChunk;
+class FPagedChunkData;
 struct FVoxelMaterial;
 
+// Called on the game thread once a requested chunk is in memory, with its chunk-space position.
+DECLARE_DELEGATE_OneParam(FOnChunkPagedIn, const FIntVector&);
+
+// Memory and paging counters for a UPagedVolumeComponent, for tuning the paging policy.
+USTRUCT(BlueprintType)
+struct POLYVOX_API FPagedVolumeStats
+{
+	GENERATED_BODY()
+public:
+	// How many chunks are currently held in memory, compressed or not.
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Stats")
+	int32 ResidentChunks = 0;
+	// How many of the resident chunks are currently compressed.
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Stats")
+	int32 CompressedChunks = 0;
+	// Bytes used by the voxel data of uncompressed chunks.
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Stats")
+	int32 UncompressedBytes = 0;
+	// Bytes used by the voxel data of compressed chunks.
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Stats")
+	int32 CompressedBytes = 0;
+	// Total number of times a cold chunk has been compressed.
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Stats")
+	int32 ChunkCompressions = 0;
+	// Total number of times a compressed chunk has been accessed again and decompressed.
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Stats")
+	int32 ChunkDecompressions = 0;
+	// How many chunk buffer requests were served by recycling an old buffer.
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Stats")
+	int32 BufferPoolHits = 0;
+	// How many chunk buffer requests needed a new allocation.
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Stats")
+	int32 BufferPoolMisses = 0;
+	// The most chunk buffer memory that has been in use at once, in bytes.
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Stats")
+	int32 BufferPoolHighWaterBytes = 0;
+	// Memory held by the pool waiting to be reused, in bytes.
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Stats")
+	int32 BufferPoolFreeBytes = 0;
+	// Total number of chunks thrown out to stay within the memory budget.
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Stats")
+	int32 ChunkEvictions = 0;
+	// How many of the evicted chunks had been modified, and so were handed to the pager to save.
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Stats")
+	int32 ChunkPageOuts = 0;
+	// How many chunk lookups were answered by an accessor's own cache, without touching the chunk table.
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Stats")
+	int32 ChunkCacheHits = 0;
+	// How many chunk lookups missed the accessor caches and had to go to the chunk table.
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Stats")
+	int32 ChunkCacheMisses = 0;
+	// How many chunks are waiting to be paged in by the worker threads.
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Stats")
+	int32 PendingPageIns = 0;
+	// Total number of chunks which have been paged in on worker threads.
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Stats")
+	int32 AsyncPageIns = 0;
+	// How many evicted chunks are waiting for the background writer to page them out.
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Stats")
+	int32 PendingPageOuts = 0;
+	// Total number of chunks which were needed again while waiting to be paged out, and were taken straight back.
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Stats")
+	int32 PageOutsReclaimed = 0;
+	// How many chunks were paged back in from the compressed cache, rather than through the pager.
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Stats")
+	int32 CompressedCacheHits = 0;
+	// How many chunks weren't in the compressed cache, and had to go through the pager.
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Stats")
+	int32 CompressedCacheMisses = 0;
+	// The fraction of page ins which were served by the compressed cache, from 0 to 1.
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Stats")
+	float CompressedCacheHitRate = 0.0f;
+	// How many evicted chunks are currently held in the compressed cache.
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Stats")
+	int32 CompressedCacheChunks = 0;
+	// Bytes used by the compressed cache. This counts towards CompressedCacheSizeInBytes, not TargetMemoryUsageInBytes.
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Stats")
+	int32 CompressedCacheBytes = 0;
+	// Total number of chunks dropped from the compressed cache to stay within its budget.
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Stats")
+	int32 CompressedCacheEvictions = 0;
+};
+
 UCLASS(Blueprintable, ClassGroup=(Custom), meta=(BlueprintSpawnableComponent) )
 class POLYVOX_API UPagedVolumeComponent : public UActorComponent
 {
 	friend class APagedVolume;
+	friend class FVolumeAccessor;
+	friend class FChunkPageInTask;
+	friend class FChunkPageOutTask;
 	GENERATED_BODY()
 
 public:	
@@ -46,14 +139,34 @@ public:
 
 	// Called when the game starts
 	virtual void BeginPlay() override;
+	// Called when the game ends; releases all chunk data and mesh actors
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
 	
 	// Called every frame
 	virtual void TickComponent( float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction ) override;
 
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Pager")
 	TSubclassOf<UPager> VolumePager;
-	UPROPERTY()
+	// If set, Prefetch() and RequestChunk() run the pager on worker threads and the chunks show up a few frames later,
+	// rather than the game thread stopping while they are generated. The pager's PageIn() must be thread-safe.
+	// Touching a voxel in a chunk which isn't in memory yet still pages it in there and then. Blueprint pagers always
+	// page in on the game thread.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Pager")
+	bool bPageInAsynchronously = true;
+	// If set, modified chunks are paged out on a background thread when they are evicted, rather than the game thread
+	// waiting for the pager to save them. The pager's PageOut() must be thread-safe. A chunk which is needed again
+	// before it has been saved is taken back from the queue without going through the pager at all. Blueprint pagers
+	// always page out on the game thread.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Pager")
+	bool bPageOutAsynchronously = true;
+	// The least recently used chunks are paged out whenever their voxel data takes up more than this.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Chunk")
 	int32 TargetMemoryUsageInBytes = 268435456;
+	// Evicted chunks are kept in memory in compressed form, up to this many bytes, so that a chunk which is needed
+	// again soon after can be decompressed instead of going back through the pager. This is on top of
+	// TargetMemoryUsageInBytes. Set to 0 to turn the cache off.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Chunk")
+	int32 CompressedCacheSizeInBytes = 33554432;
 	// The size of the chunks
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Chunk")
 	uint8 ChunkSideLength;
@@ -64,6 +177,10 @@ public:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Noise")
 	int32 RandomSeed = 123;
 
+	// Chunks which haven't been accessed for this many ticks get compressed in memory. Set to 0 to never compress.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Chunk")
+	int32 TicksBeforeCompression = 300;
+
 	UFUNCTION(BlueprintPure, Category = "Volume|Voxels")
 		virtual FVoxel GetVoxelByCoordinates(int32 XPos, int32 YPos, int32 ZPos);
 	UFUNCTION(BlueprintPure, Category = "Volume|Voxels")
@@ -77,27 +194,62 @@ public:
 	UFUNCTION(BlueprintCallable, Category = "Volume|Voxels")
 	virtual void PageInChunksAroundPlayer(AController* PlayerController, const int32 MaxWorldHeight, const uint8 NumberOfChunksToPageIn, TArray<FVoxelMaterial> Materials, bool bUseMarchingCubes);
 
-	// Tries to ensure that the voxels within the specified Region are loaded into memory.
+	// Tries to ensure that the voxels within the specified Region are loaded into memory. Returns the chunk-space
+	// positions of the chunks covering the region. With asynchronous paging, this only starts paging them in.
 	UFUNCTION(BlueprintCallable, Category = "Volume|Utility")
-		TArray<APagedChunk*> Prefetch(FRegion PrefetchRegion);
+		TArray<FIntVector> Prefetch(FRegion PrefetchRegion);
+	// Prefetches a region, then waits until every chunk in it is in memory before carrying on.
+	UFUNCTION(BlueprintCallable, Category = "Volume|Utility", meta = (Latent, LatentInfo = "LatentInfo"))
+		void PrefetchAndWait(FRegion PrefetchRegion, FLatentActionInfo LatentInfo);
+	// Whether the chunk at a chunk-space position is in memory, so it can be used without waiting for the pager.
+	UFUNCTION(BlueprintPure, Category = "Volume|Utility")
+		bool IsChunkResident(const FIntVector& ChunkPosition) const;
+	// Starts paging in the chunk at a chunk-space position, if it isn't in memory already. OnPagedIn is called on the
+	// game thread once it is, which is straight away if it already was (or if paging is synchronous).
+	// Only call this from the game thread.
+	void RequestChunk(const FIntVector& ChunkPosition, FOnChunkPagedIn OnPagedIn = FOnChunkPagedIn());
 	// Removes all voxels from memory
 	UFUNCTION(BlueprintCallable, Category = "Volume|Utility")
 		void FlushAll();
+	// Blocks until every evicted chunk which is waiting to be saved has been handed to the pager. Call this at save
+	// points, so that everything evicted so far is on disk.
+	UFUNCTION(BlueprintCallable, Category = "Volume|Utility")
+		void FlushPageOuts();
 
-	//UFUNCTION(BlueprintPure, Category = "Volume|Utility")
-	//virtual bool RegionIsEmpty(const FRegion& Region) override;
+	// Returns true if no voxel in the region (including its upper bound) is solid.
+	UFUNCTION(BlueprintPure, Category = "Volume|Utility")
+		bool IsRegionEmpty(const FRegion& Region);
 
 	UFUNCTION(BlueprintPure, Category = "Volume|Utility")
 		virtual int32 CalculateSizeInBytes() const;
 
+	UFUNCTION(BlueprintPure, Category = "Volume|Utility")
+		FPagedVolumeStats GetVolumeStats() const;
+
+	// Returns true if every chunk overlapping the region (including its upper bound) is entirely solid or entirely
+	// empty, and they all agree. This only looks at whole chunks, so a region with no surface in it can be skipped cheaply.
+	// Unless bPageIn is set, chunks which aren't resident aren't paged in, and the answer is false if there are any.
+	UFUNCTION(BlueprintPure, Category = "Volume|Utility")
+		bool IsRegionUniformlySolidOrEmpty(const FRegion& Region, bool bPageIn = true);
+
 	UFUNCTION(BlueprintCallable, Category = "Volume|Mesh")
 		void CreateMarchingCubesMesh(FRegion Region, TArray<FVoxelMaterial> VoxelMaterials);
 
 	virtual uint8 GetChunkSideLength() const;
 	virtual uint8 GetSideLengthPower() const;
-	APagedChunk* GetLastAccessedChunk() const;
-	bool CanReuseLastAccessedChunk(int32 iChunkX, int32 iChunkY, int32 iChunkZ) const;
-	APagedChunk* GetChunk(int32 uChunkX, int32 uChunkY, int32 uChunkZ);
+	// Returns the chunk at a chunk-space position, paging it in if need be. The chunk isn't pinned, so this is only
+	// safe on the game thread, and the pointer must not be kept past the next tick. Other threads should go through
+	// an FVolumeAccessor instead.
+	FPagedChunkData* GetChunk(int32 uChunkX, int32 uChunkY, int32 uChunkZ);
+	// Bricks are the occupancy summary's unit of space, see FPagedChunkData. Brick coordinates are in world space,
+	// so brick (x, y, z) covers voxels (x, y, z) << GetBrickSideLengthPower() onwards.
+	uint8 GetBrickSideLengthPower() const;
+	// Unless bPageIn is set, bricks in chunks which aren't resident are reported as Mixed rather than paging them in.
+	EBrickOccupancy GetBrickOccupancy(int32 BrickX, int32 BrickY, int32 BrickZ, bool bPageIn = true);
+	// Chunk meshes are extracted in cubic blocks of this many voxels (as a power of two), so that an edit only
+	// needs the blocks around it to be extracted again.
+	static const uint8 MESH_BLOCK_SIDE_LENGTH_POWER = 4;
+	uint8 GetMeshBlockSideLengthPower() const;
 
 	// Flattens a region to be exactly a specific height.
 	// Any Voxels above this height are turned to air.
@@ -129,37 +281,182 @@ public:
 
 	UFUNCTION(BlueprintCallable, Category = "Volume|Debug")
 		void DrawVolumeAsDebug(const FRegion& DebugRegion);
+	// Compares the pager's two entry points. Sets up ChunkCount chunks the way the volume does and times the pager
+	// filling them through one PageIn() call per chunk, then does the same with fresh chunks through PageInBatch() in
+	// the batches the workers use. The chunks are never added to the volume. Logs both rates, and returns how many
+	// times faster the batched fill was (below 1 if it was slower).
+	UFUNCTION(BlueprintCallable, Category = "Volume|Debug")
+		float ComparePageInBatching(int32 ChunkCount = 256);
+	// Benchmarks voxel reads. Walks a sampler over every voxel of the chunk at the origin Passes times, the way the
+	// mesh extractor does, and returns (and logs) how many voxels per second it read.
+	UFUNCTION(BlueprintCallable, Category = "Volume|Debug")
+		float MeasureSamplerReadRate(int32 Passes = 16);
 
-	UPROPERTY()
-		APagedChunk* LastAccessedChunk = nullptr;
+	// Calls Visitor once for each chunk overlapping the region, with a view of the part of the chunk inside it. Like
+	// the bulk functions above, the region's upper bound is excluded. Chunks are visited a Z layer at a time, from the
+	// bottom up unless bTopDown is set, and within each layer in Y then X order.
+	// This is the fast way to read or write lots of voxels: there is one chunk lookup per chunk rather than per voxel,
+	// and writes are marked dirty (and queued for remeshing) once per chunk.
+	void VisitRegion(const FRegion& Region, TFunctionRef<void(FChunkRegionView&)> Visitor, bool bTopDown = false);
 
 private:
-	TQueue<APagedChunk*> ChunksToCreateMesh;
-	UPROPERTY()
-		APagedChunk* ChunkCurrentlyMakingMeshFor;
+	// Extracts the dirty part of a chunk's mesh, spawning an actor to display it if there is anything to show.
+	void CreateChunkMesh(FPagedChunkData* Chunk);
+	// Whether a chunk and the positive neighbours its mesh reads from are all in memory. If not, they're requested.
+	bool RequestMeshInputs(const FIntVector& ChunkPos);
+	// Adds a chunk to the list waiting to be paged in, unless it can be had straight away (because it is resident, or
+	// is still waiting to be paged out), in which case this returns false. The list is handed out by StartPageIns().
+	bool QueuePageIn(const FIntVector& ChunkPosition, FOnChunkPagedIn OnPagedIn);
+	// Pages in every chunk waiting in ChunksToPageIn, in batches. With asynchronous paging this just starts the
+	// workers off; otherwise the chunks are in the table by the time it returns.
+	void StartPageIns();
+	// Adds chunks the workers have finished paging in to the chunk table, and tells whoever asked for them.
+	void PublishPagedInChunks();
+	// Blocks until every page in running on a worker has finished, then throws the results away.
+	void CancelPageIns();
+	// Hands a modified chunk to the background writer, starting it if it isn't already running.
+	void QueuePageOut(FPagedChunkData* Chunk);
+	// Run by the background writer; pages out queued chunks until there are none left.
+	void WritePendingPageOuts();
+	bool IsPageOutQueued(const FIntVector& ChunkPosition) const;
+	// Blocks while the chunk at this position is in the middle of being paged out.
+	void WaitForPageOut(const FIntVector& ChunkPosition) const;
+	// Called once a chunk in ChunksBeingPagedOut has been saved.
+	void FinishPageOut(const FIntVector& ChunkPosition);
+	// If the chunk at this position is waiting to be paged out, takes it back off the queue and puts it back in the
+	// chunk table. Must be called with ChunkTableLock held for writing.
+	FPagedChunkData* ReclaimPageOut(const FIntVector& ChunkPosition);
+	// Queues a mesh update for a chunk which has just been dirtied, if it has been meshed before.
+	void QueueChunkMesh(FPagedChunkData* Chunk);
+	// Returns a chunk if it is resident, without paging it in or decompressing it.
+	FPagedChunkData* FindChunk(int32 ChunkX, int32 ChunkY, int32 ChunkZ) const;
+	// Finds or pages in a chunk, decompressing it if need be. If bPin is set, the chunk is pinned before the table
+	// lock is released, so it can't be compressed or evicted until it is unpinned.
+	FPagedChunkData* FindOrLoadChunk(int32 ChunkX, int32 ChunkY, int32 ChunkZ, bool bPin);
+	// Pinned chunks are never compressed or evicted. Pins are counted, so every pin needs a matching unpin.
+	FPagedChunkData* GetPinnedChunk(int32 ChunkX, int32 ChunkY, int32 ChunkZ);
+	// Pins a chunk only if it is resident, decompressing it if need be. This never pages anything in or changes which
+	// chunks are in the table; it returns NULL instead.
+	FPagedChunkData* GetPinnedChunkIfResident(int32 ChunkX, int32 ChunkY, int32 ChunkZ);
+	void PinChunk(FPagedChunkData* Chunk);
+	void UnpinChunk(FPagedChunkData* Chunk);
+	// Writes a voxel into a chunk the caller has pinned, then queues mesh updates for it and any neighbours whose
+	// meshes read the voxel.
+	void SetVoxelInChunk(FPagedChunkData* Chunk, const FIntVector& ChunkPos, const FIntVector& Offset, FVoxel Voxel);
+	// Dirties the meshes of neighbours which read the given box of a chunk (in chunk space, inclusive).
+	void MarkNeighboursDirty(const FIntVector& ChunkPos, const FIntVector& Lower, const FIntVector& Upper);
+	// Times the pager filling ChunkCount chunks which are never added to the volume, and returns how many chunks per
+	// second that came to.
+	float MeasurePageInRate(int32 ChunkCount, bool bBatched);
+	// Makes each column of the region solid up to its height (in world space) and empty above it. Columns are in
+	// X-major order, one per X/Y position in the region.
+	void StampColumns(const FRegion& Region, const TArray<int32>& ColumnHeights, const TArray<FVoxel>& ColumnFillers);
+	FVolumeAccessor& GetGameThreadAccessor();
+	// Pages out a chunk (or queues it for the background writer), destroys its mesh actor (if any) and frees its data.
+	// Unless bKeepCompressedCopy is cleared, its voxels are kept in the compressed cache.
+	void DeleteChunk(FPagedChunkData* Chunk, bool bKeepCompressedCopy = true);
+	// Fills in a chunk which isn't resident, from the compressed cache if it is in there and from the pager if not.
+	void LoadChunk(FPagedChunkData* Chunk, const FIntVector& ChunkPosition);
+	// LoadChunk() for several chunks at once, which are appended to OutChunks. Anything which isn't in the compressed
+	// cache goes to the pager in a single batch.
+	void LoadChunks(const TArray<FIntVector>& ChunkPositions, TArray<FPagedChunkData*>& OutChunks);
+	// Hands a chunk to the pager if it has been modified, then frees it, keeping a copy of its voxels in the
+	// compressed cache if asked to.
+	void PageOutChunk(FPagedChunkData* Chunk, bool bKeepCompressedCopy);
+	// Looks through part of the chunk array for chunks which haven't been used recently, and compresses them.
+	void CompressColdChunks();
+	// Pages out the least recently used chunks until the volume is back within TargetMemoryUsageInBytes.
+	void EvictChunks();
+	// Total bytes of voxel data held by resident chunks.
+	int64 GetResidentBytes() const;
+	// Moves a chunk to the front of the recently used list, adding it if it isn't there yet.
+	void MarkChunkUsed(FPagedChunkData* Chunk);
+	void RemoveFromRecentlyUsed(FPagedChunkData* Chunk);
+
+	// Chunk-space positions of chunks waiting for a mesh. Positions are queued rather than chunks so that a chunk
+	// being paged out before Tick gets to it is harmless. Edits made on other threads queue here too.
+	TQueue<FIntVector, EQueueMode::Mpsc> ChunksToCreateMesh;
+	// Chunks which were due a mesh, but are waiting for themselves or a neighbour to be paged in first.
+	TArray<FIntVector> ChunksAwaitingPageIn;
+
+	// A chunk being paged in on a worker thread.
+	struct FPendingPageIn
+	{
+		TArray<FOnChunkPagedIn> Callbacks;
+		// Set if a chunk at this position was paged out while the worker was busy. What the worker read from the
+		// pager may be older than what was saved, so the result is thrown away and the page in started again.
+		bool bStale = false;
+	};
+	// Requested chunks which are still being paged in, by chunk-space position. Only touched on the game thread.
+	TMap<FIntVector, FPendingPageIn> PendingPageIns;
+	// Requested chunks which haven't been handed to a worker yet.
+	TArray<FIntVector> ChunksToPageIn;
+	// The most chunks handed to a single worker at once.
+	static const int32 PAGE_IN_BATCH_SIZE = 8;
+	// Chunks the workers have finished with, waiting for the game thread to add them to the chunk table.
+	TQueue<FPagedChunkData*, EQueueMode::Mpsc> PagedInChunks;
+	// Batches of page ins which have been started but haven't reached PagedInChunks yet.
+	FThreadSafeCounter PageInsInFlight;
+	int32 AsyncPageIns = 0;
+
+	// Evicted chunks waiting to be paged out by the background writer, by chunk-space position.
+	TMap<FIntVector, FPagedChunkData*> PendingPageOuts;
+	// Chunks which are being saved right now, either by the writer or by a synchronous eviction. They are in neither
+	// the table nor PendingPageOuts, so anyone wanting one of these has to wait for the save to finish.
+	TSet<FIntVector> ChunksBeingPagedOut;
+	bool bPageOutWriterRunning = false;
+	// Bumped whenever a chunk is queued, or evicted to be paged out synchronously. A thread paging a chunk in from the
+	// pager checks this hasn't changed before adding it to the table, as otherwise a newer copy may have been evicted
+	// (and maybe saved) in the meantime.
+	uint32 PageOutGeneration = 0;
+	// Guards everything above. Always taken after ChunkTableLock, never before.
+	mutable FCriticalSection PageOutLock;
+	// Writers which have been started and haven't finished yet. The writer decrements this as the very last thing it
+	// does, so the volume is safe to destroy once it reaches zero.
+	FThreadSafeCounter PageOutWritersInFlight;
+	int32 PageOutsReclaimed = 0;
 	UPROPERTY()
 		TArray<FVoxelMaterial> ChunkMaterials;
 
-	UPROPERTY()
-		int32 LastAccessedChunkX = 0;
-	UPROPERTY()
-		int32 LastAccessedChunkY = 0;
-	UPROPERTY()
-		int32 LastAccessedChunkZ = 0;
-
 	UPROPERTY()
 		int32 ChunkCountLimit = 0;
 
-	// Chunks are stored in the following array which is used as a hash-table. Conventional wisdom is that such a hash-table
-	// should not be more than half full to avoid conflicts, and a practical chunk size seems to be 64^3. With this configuration
-	// there can be up to 32768*64^3 = 8 gigavoxels (with each voxel perhaps being many bytes). This should effectively make use 
-	// of even high end machines. Of course, the user can choose to limit the memory usage in which case much less of the chunk 
-	// array will actually be used. None-the-less, we have chosen to use a fixed size array (rather than a vector) as it appears to 
-	// be slightly faster (probably due to the extra pointer indirection in a vector?) and the actual size of this array should
-	// just be 1Mb or so.
-	static const uint32 CHUNK_ARRAY_SIZE = 65536;
-	UPROPERTY()
-		TArray<APagedChunk*> ArrayChunks;
+	// Incremented every tick; chunks are stamped with this when accessed.
+	uint32 CurrentTick = 0;
+	// Where the cold chunk sweep will pick up from next tick.
+	uint32 CompressionSweepIndex = 0;
+	int32 ChunkCompressions = 0;
+	int32 ChunkDecompressions = 0;
+	int32 ChunkEvictions = 0;
+	int32 ChunkPageOuts = 0;
+	// Accessors add their cache counters to these when they are destroyed.
+	FThreadSafeCounter ChunkCacheHits;
+	FThreadSafeCounter ChunkCacheMisses;
+
+	// Enough to make sure a chunk and its neighbors can be loaded, with a few to spare. Eviction never goes below this.
+	static const int32 MIN_RESIDENT_CHUNKS = 32;
+	// Working out how much memory is in use means visiting every chunk, so it isn't done every tick.
+	static const uint32 EVICTION_INTERVAL_TICKS = 16;
+	// Ends of the recently used list threaded through the chunks.
+	FPagedChunkData* MostRecentlyUsedChunk = nullptr;
+	FPagedChunkData* LeastRecentlyUsedChunk = nullptr;
+	// Guards the recently used list. Always taken after ChunkTableLock, never before.
+	FCriticalSection RecentlyUsedLock;
+	// Guards ChunkTable. Lookups take it for reading; adding, removing, compressing and decompressing chunks take it
+	// for writing.
+	mutable FRWLock ChunkTableLock;
+	// Used by GetVoxelByCoordinates() and SetVoxelByCoordinates(). Created on first use.
+	TUniquePtr<FVolumeAccessor> GameThreadAccessor;
+
+	// Every resident chunk, by chunk-space position. The table grows as needed, so the number of chunks is only
+	// limited by ChunkCountLimit.
+	// Chunk data is owned by this component and is not visible to the garbage collector.
+	FChunkHashTable ChunkTable;
+	// Recycles voxel buffers between chunks as they are paged in and out.
+	FChunkBufferPool ChunkBufferPool;
+	// Recently evicted chunks, compressed. Chunks only go in once they have been paged out, so something which misses
+	// here can always fall back on the pager.
+	FCompressedChunkCache CompressedChunkCache;
 
 	UPROPERTY()
 		uint8 ChunkSideLengthPower;
@@ -27,14 +27,19 @@ SOFTWARE.
 
 #include "UObject/NoExportTypes.h"
 #include "RegionHelper.h"
+#include "Voxel.h"
 #include "Pager.generated.h"
 
-class APagedChunk;
+class FPagedChunkData;
 
 /** 
 * Users can override this class and provide an instance of the derived class to the PagedVolume constructor. This derived class
 * could then perform tasks such as compression and decompression of the data, and read/writing it to a file, database, network,
 * or other storage as appropriate.
+*
+* Chunks are plain C++ data rather than actors, so a Blueprint pager implements the "Page In" and "Page Out" events
+* instead, which work on a copy of the chunk's voxels. Blueprints can only run on the game thread, so a volume with
+* one of these pages synchronously.
 */
 UCLASS(Blueprintable)
 class POLYVOX_API UPager : public UObject
@@ -46,12 +51,30 @@ public:
 	/// Destructor
 	virtual ~UPager() {};
 
-	UFUNCTION(BlueprintNativeEvent, Category = "Pager")
-	void PageIn(const FRegion& Region, APagedChunk* Chunk);
-	UFUNCTION(BlueprintNativeEvent, Category = "Pager")
-	void PageOut(const FRegion& Region, APagedChunk* Chunk);
+	// Called when a chunk is first touched, giving the pager a chance to fill it with voxels.
+	// When the volume pages in asynchronously this runs on a worker thread, possibly for several chunks
+	// at once, so it must not touch the world or change any state shared between calls.
+	virtual void PageIn(const FRegion& Region, FPagedChunkData* Chunk);
+	// Fills several chunks at once. The volume pages chunks in through this whenever it has more than one to fetch,
+	// so pagers with expensive setup (noise generators, lookups shared between neighbouring chunks) can override
+	// it to do that work once per batch. Each chunk's region is its ChunkRegion. By default this calls PageIn() on
+	// each chunk in turn. The same threading rules apply as for PageIn().
+	virtual void PageInBatch(const TArray<FPagedChunkData*>& Chunks);
+	// Called before a modified chunk is discarded, giving the pager a chance to save its voxels.
+	// When the volume pages out asynchronously this runs on a background thread, alongside any page ins.
+	// By default this hands the voxels to ReceivePageOut() if a Blueprint implements it.
+	virtual void PageOut(const FRegion& Region, FPagedChunkData* Chunk);
+
+	// Whether this is a Blueprint pager implementing either event, which means it can only be used on the game thread.
+	bool IsImplementedInBlueprint() const;
 
 protected:
-	virtual void PageIn_Implementation(const FRegion& Region, APagedChunk* Chunk);
-	virtual void PageOut_Implementation(const FRegion& Region, APagedChunk* Chunk);
+	// Fills a chunk from Blueprint. Voxels holds every voxel in the region in X-major order
+	// (index = x + y * side + z * side^2), all empty air to begin with. Called by the default PageIn().
+	UFUNCTION(BlueprintImplementableEvent, Category = "Pager", meta = (DisplayName = "Page In"))
+	void ReceivePageIn(const FRegion& Region, TArray<FVoxel>& Voxels);
+	// Saves a modified chunk from Blueprint. Voxels are in the same order as ReceivePageIn(). Called by the default
+	// PageOut().
+	UFUNCTION(BlueprintImplementableEvent, Category = "Pager", meta = (DisplayName = "Page Out"))
+	void ReceivePageOut(const FRegion& Region, const TArray<FVoxel>& Voxels);
 };
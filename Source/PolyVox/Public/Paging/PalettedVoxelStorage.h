@@ -0,0 +1,117 @@
+/*******************************************************************************
+The MIT License (MIT)
+
+Copyright (c) 2017 Jay Stevens
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*******************************************************************************/
+
+#pragma once
+
+#include "Voxel.h"
+
+class FChunkBufferPool;
+
+/**
+ * Stores a chunk's voxels as a palette of the distinct values it contains plus a bit-packed index into that palette
+ * for every voxel. Most chunks only contain a handful of different voxels, so this is usually 4-16x smaller than
+ * storing an FVoxel per voxel.
+ *
+ * A freshly initialised store is "uniform": it holds a single palette entry and no indices at all. The first write of
+ * a different value expands it to 1-bit indices, which then grow to 2, 4, 8 and finally 16 bits as new values are
+ * added to the palette. Indices never straddle two words, since every width divides 64 evenly.
+ */
+class POLYVOX_API FPalettedVoxelStorage
+{
+public:
+	FPalettedVoxelStorage();
+	~FPalettedVoxelStorage();
+
+	// Index buffers will be taken from (and returned to) this pool rather than the heap. This empties the store.
+	void SetBufferPool(FChunkBufferPool* Pool);
+
+	// Sets up storage for the given number of voxels, all set to the Fill value. This allocates no indices.
+	void Init(int32 NumberOfVoxels, FVoxel Fill = FVoxel::GetEmptyVoxel());
+	// Whether every voxel has the same value (the first palette entry).
+	bool IsUniform() const;
+	// Frees all storage.
+	void Empty();
+	int32 Num() const;
+
+	FORCEINLINE FVoxel Get(uint32 Index) const
+	{
+		checkf(Index < (uint32)VoxelCount, TEXT("Voxel index %d out of bounds of voxel data size %d!"), Index, VoxelCount);
+		return GetUnchecked(Index);
+	}
+	// Get() with the bounds check only in slow-check builds, for inner loops which already know the index is good.
+	FORCEINLINE FVoxel GetUnchecked(uint32 Index) const
+	{
+		checkfSlow(Index < (uint32)VoxelCount, TEXT("Voxel index %d out of bounds of voxel data size %d!"), Index, VoxelCount);
+		if (BitsPerIndex == 0)
+		{
+			return Palette[0];
+		}
+		const uint32 word = Index >> IndicesPerWordPower;
+		const uint32 shift = (Index & IndicesPerWordMask) * BitsPerIndex;
+		return Palette[(int32)((IndexWords[word] >> shift) & IndexMask)];
+	}
+	void Set(uint32 Index, FVoxel Value);
+	// Sets every voxel whose bit is set in Mask (one bit per voxel, in storage order) to Value. This works a word of
+	// indices at a time, so it is much faster than calling Set() on each voxel.
+	void SetMasked(const TArray<uint64>& Mask, FVoxel Value);
+	// Replaces every voxel at once. Values must hold Num() voxels, in storage order.
+	void SetAll(const FVoxel* Values);
+
+	// Drops any palette entries which are no longer used and shrinks the indices to match.
+	void Compact();
+
+	// Writes the palette plus a run-length encoding of the indices (in storage order) to a byte array.
+	void CompressRLE(TArray<uint8>& OutBytes) const;
+	// Replaces the contents of this store with data written by CompressRLE. Returns false if the data is malformed or
+	// doesn't hold exactly ExpectedVoxelCount voxels, in which case the store is left as it was.
+	bool DecompressRLE(const TArray<uint8>& InBytes, int32 ExpectedVoxelCount);
+
+	int32 GetPaletteSize() const;
+	uint8 GetBitsPerIndex() const;
+	// How much memory the voxel data is currently using.
+	int32 GetSizeInBytes() const;
+
+private:
+	int32 FindOrAddPaletteEntry(const FVoxel& Value);
+	// Re-encodes every index with a new width, optionally mapping each one to a new palette slot on the way.
+	void Repack(uint8 NewBitsPerIndex, const TArray<uint16>* Remap = nullptr);
+	void SetIndexWidth(uint8 NewBitsPerIndex);
+	void AllocateWords(TArray<uint64>& Words, int32 NumWords);
+	void FreeWords(TArray<uint64>& Words);
+
+	static uint8 GetBitsForPaletteSize(int32 PaletteSize);
+
+	FChunkBufferPool* BufferPool;
+	TArray<FVoxel> Palette;
+	TArray<uint64> IndexWords;
+
+	int32 VoxelCount;
+	uint8 BitsPerIndex;
+	uint8 IndicesPerWordPower;
+	uint32 IndicesPerWordMask;
+	uint64 IndexMask;
+
+	// Runs of identical voxels are common when paging in, so remember which palette entry we used last.
+	int32 LastPaletteIndex;
+};
@@ -0,0 +1,110 @@
+/*******************************************************************************
+The MIT License (MIT)
+
+Copyright (c) 2017 Jay Stevens
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*******************************************************************************/
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Misc/ScopeLock.h"
+
+class IFileHandle;
+
+/**
+ * One file on disk holding the saved voxels for a 16x16x16 block of chunks.
+ *
+ * The file starts with a small header (magic number, format version and chunk size) followed by a table with one
+ * entry per chunk giving the offset, reserved space, size and CRC of that chunk's data. What the data means is up to
+ * the pager (see URegionFilePager). Loading a chunk is one seek and one read, as the table is kept in memory once the
+ * file has been opened.
+ *
+ * A chunk is never rewritten in place: its new data goes into space nothing else is using, and only once that has
+ * been written is the chunk's table entry switched over to it. A write which is cut short leaves the old data and the
+ * entry pointing at it untouched. The space a chunk used to take up is then reused for later writes. Data which fails
+ * its checksum is reported as missing, so the chunk gets generated again rather than loading garbage. This is safe to
+ * use from multiple threads.
+ */
+class POLYVOX_API FRegionFile
+{
+public:
+	// Regions are 16 chunks on a side.
+	static const int32 REGION_SIDE_LENGTH_POWER = 4;
+	static const int32 CHUNKS_PER_REGION = 1 << (REGION_SIDE_LENGTH_POWER * 3);
+
+	// Nothing is opened until a chunk is read or written. The file is only created by the first write.
+	FRegionFile(const FString& RegionFilePath, uint8 RegionChunkSideLength);
+	~FRegionFile();
+
+	// Fills OutBytes with the saved data for a chunk. Returns false if the chunk has never been saved, or if its
+	// data can't be read back intact.
+	bool ReadChunk(const FIntVector& ChunkPosition, TArray<uint8>& OutBytes);
+	// Saves the data for a chunk, replacing whatever was saved for it before.
+	bool WriteChunk(const FIntVector& ChunkPosition, const TArray<uint8>& Bytes);
+	// Closes the file and lets go of its table. Both come back the next time a chunk is read or written.
+	void Close();
+
+	// The position of the region containing the given chunk.
+	static FIntVector GetRegionPosition(const FIntVector& ChunkPosition);
+
+private:
+	// A chunk's entry in the table. A size of 0 means the chunk has never been saved.
+	struct FChunkEntry
+	{
+		uint32 Offset;
+		uint32 Capacity;
+		uint32 Size;
+		uint32 Checksum;
+	};
+	// Space in the file which no chunk's entry points at.
+	struct FFreeSpan
+	{
+		uint32 Offset;
+		uint32 Length;
+	};
+
+	static int32 GetEntryIndex(const FIntVector& ChunkPosition);
+	// Opens the file (creating it if we're about to write) and loads its table. Returns false if the file
+	// doesn't exist yet or can't be used.
+	bool OpenFile(bool bForWriting);
+	bool ReadTable();
+	bool WriteTable();
+	bool WriteEntry(int32 Index);
+	// Finds somewhere to put a chunk's data which doesn't overlap anything in use, preferring free spans over growing
+	// the file.
+	uint32 AllocateSpace(uint32 Length);
+	// Hands space back once nothing points at it any more, merging it with any free neighbours.
+	void ReleaseSpace(uint32 Offset, uint32 Length);
+
+	FString FilePath;
+	uint8 ChunkSideLength;
+	TArray<FChunkEntry> Entries;
+	TUniquePtr<IFileHandle> FileHandle;
+	bool bIsWritable;
+	// Set if the file exists but was written by an incompatible version, or for a different chunk size.
+	// It is left alone rather than overwritten.
+	bool bIsIncompatible;
+	// Where the next chunk which doesn't fit in any of the free spans will go.
+	uint32 EndOfFile;
+	// Sorted by offset, and never adjacent to each other.
+	TArray<FFreeSpan> FreeSpans;
+	FCriticalSection FileLock;
+};
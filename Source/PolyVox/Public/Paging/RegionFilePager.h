@@ -0,0 +1,91 @@
+/*******************************************************************************
+The MIT License (MIT)
+
+Copyright (c) 2017 Jay Stevens
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*******************************************************************************/
+
+#pragma once
+
+#include "Paging/Pager.h"
+#include "Misc/ScopeLock.h"
+#include "RegionFilePager.generated.h"
+
+class FRegionFile;
+
+/**
+ * A pager which saves modified chunks to disk and loads them back again, so edits survive chunks being evicted and
+ * the game being restarted.
+ *
+ * Chunks are grouped into region files of 16x16x16 chunks each (see FRegionFile), kept in a folder under the
+ * project's Saved directory. Chunks which have never been saved are handed to the generator pager instead, so this
+ * can sit in front of any other pager.
+ *
+ * If the generator always makes the same chunk from the same seed, bSaveEditsOnly stores just the voxels which differ
+ * from what it makes. Page-in then regenerates the chunk and puts the edits back on top.
+ */
+UCLASS(Blueprintable)
+class POLYVOX_API URegionFilePager : public UPager
+{
+	GENERATED_BODY()
+public:
+	URegionFilePager();
+
+	// The folder region files are kept in, relative to the project's Saved directory. Each volume needs its own.
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Region Files")
+	FString SaveFolder;
+
+	// Fills in chunks which haven't been saved yet. If this is empty they start out as empty air.
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Region Files")
+	TSubclassOf<UPager> GeneratorPager;
+
+	// Only save the voxels which have been changed from what the generator makes, rather than whole chunks.
+	// This is far smaller for lightly edited worlds, but the generator has to be deterministic.
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Region Files")
+	bool bSaveEditsOnly;
+
+	virtual void PostInitProperties() override;
+	virtual void BeginDestroy() override;
+
+	virtual void PageIn(const FRegion& Region, FPagedChunkData* Chunk) override;
+	virtual void PageInBatch(const TArray<FPagedChunkData*>& Chunks) override;
+	virtual void PageOut(const FRegion& Region, FPagedChunkData* Chunk) override;
+
+private:
+	// Finds the region file which the given chunk is saved in, creating an entry for it if this is the first time.
+	// If too many region files have been used since, the least recently used one is closed.
+	FRegionFile* GetRegionFile(const FIntVector& ChunkPosition, uint8 ChunkSideLength);
+	// Writes out every voxel which differs between the chunk and what the generator makes for it.
+	// Returns false if that would be no smaller than saving the whole chunk.
+	bool SerializeEdits(const FRegion& Region, FPagedChunkData* Chunk, int32 MaxBytes, TArray<uint8>& OutBytes);
+	// Applies edits written by SerializeEdits() to a chunk the generator has just filled in.
+	bool ApplyEdits(FPagedChunkData* Chunk, const TArray<uint8>& Bytes);
+
+	UPROPERTY()
+	UPager* Generator;
+
+	// Region files by region position. These are owned by the pager, and are kept around even once closed since
+	// another thread may still be using one.
+	TMap<FIntVector, FRegionFile*> RegionFiles;
+	// Regions whose files may be open, least recently used first.
+	TArray<FIntVector> RecentlyUsedRegions;
+	// Chunks are paged in on worker threads, so the map needs guarding.
+	FCriticalSection RegionFilesLock;
+};
@@ -0,0 +1,106 @@
+/*******************************************************************************
+The MIT License (MIT)
+
+Copyright (c) 2017 Jay Stevens
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*******************************************************************************/
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Voxel.h"
+
+class UPagedVolumeComponent;
+class FPagedChunkData;
+
+/**
+ * Reads and writes the voxels of a UPagedVolumeComponent on behalf of a single thread.
+ *
+ * The volume itself can be shared between threads, but looking chunks up in it takes a lock. Accessors remember the
+ * last few chunks they used so that runs of nearby voxels skip the lookup, and keep those chunks pinned so the volume
+ * won't compress or evict them while the accessor might still be reading them.
+ *
+ * The cache is direct-mapped on the low bit of each chunk coordinate, so the 8 chunks of any 2x2x2 block can be held
+ * at once. Work which reads across a chunk seam (such as marching cubes reading its +X neighbour) keeps hitting.
+ *
+ * An accessor must only be used by one thread at a time; give each worker its own. Any number of threads can read
+ * the same chunk at once, but a chunk must not be written while another thread is reading or writing it.
+ * Accessors must be destroyed before the volume they read from.
+ *
+ * A resident-only accessor never pages chunks in. Chunks which aren't resident come back as NULL (and read as empty
+ * air through GetVoxel), and keep doing so until the accessor is reset, so it sees a stable set of chunks.
+ */
+class POLYVOX_API FVolumeAccessor
+{
+public:
+	FVolumeAccessor(UPagedVolumeComponent* VolumeData, bool bOnlyResidentChunks = false);
+	FVolumeAccessor(const FVolumeAccessor& Other);
+	FVolumeAccessor& operator=(const FVolumeAccessor& Other);
+	~FVolumeAccessor();
+
+	FVoxel GetVoxel(int32 XPos, int32 YPos, int32 ZPos);
+	void SetVoxel(int32 XPos, int32 YPos, int32 ZPos, FVoxel Voxel);
+
+	// Returns the chunk at a chunk-space position, paging it in if need be (or returning NULL, if this accessor is
+	// resident-only). It stays pinned until another chunk takes its place in the cache, or this accessor is reset.
+	FORCEINLINE FPagedChunkData* GetChunk(int32 ChunkX, int32 ChunkY, int32 ChunkZ)
+	{
+		FCacheEntry& entry = Cache[(ChunkX & 1) | ((ChunkY & 1) << 1) | ((ChunkZ & 1) << 2)];
+		if (entry.bIsFilled && entry.X == ChunkX && entry.Y == ChunkY && entry.Z == ChunkZ)
+		{
+			CacheHits++;
+			return entry.Chunk;
+		}
+		return FillCacheEntry(entry, ChunkX, ChunkY, ChunkZ);
+	}
+	// Unpins every cached chunk.
+	void Reset();
+
+	UPagedVolumeComponent* GetVolume() const;
+	bool IsResidentOnly() const;
+
+	// How many chunk lookups were answered from the cache, and how many had to go to the volume.
+	int32 GetCacheHits() const;
+	int32 GetCacheMisses() const;
+
+	static const int32 CACHE_SIZE = 8;
+
+private:
+	struct FCacheEntry
+	{
+		FPagedChunkData* Chunk;
+		// Set once the entry has been looked up. Resident-only accessors cache misses too, as a NULL chunk.
+		bool bIsFilled;
+		int32 X;
+		int32 Y;
+		int32 Z;
+	};
+
+	FPagedChunkData* FillCacheEntry(FCacheEntry& Entry, int32 ChunkX, int32 ChunkY, int32 ChunkZ);
+	void CopyCache(const FVolumeAccessor& Other);
+	void FlushCounters();
+
+	UPagedVolumeComponent* Volume;
+	bool bResidentOnly;
+
+	FCacheEntry Cache[CACHE_SIZE];
+	int32 CacheHits;
+	int32 CacheMisses;
+};
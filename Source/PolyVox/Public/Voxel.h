@@ -49,6 +49,15 @@ public:
 		bIsSolid = false;
 	}
 
+	bool operator==(const FVoxel& Other) const
+	{
+		return Material == Other.Material && bIsSolid == Other.bIsSolid;
+	}
+	bool operator!=(const FVoxel& Other) const
+	{
+		return !(*this == Other);
+	}
+
 	static FVoxel GetEmptyVoxel();
 
 	static FVoxel MakeVoxel(uint8 MaterialID, bool bShouldBeSolid);